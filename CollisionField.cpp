@@ -0,0 +1,147 @@
+#include "CollisionField.h"
+#include <algorithm>
+#include <cmath>
+
+const float RESTITUTION = 0.6f;         // Share of the into-wall speed kept on the way back out
+
+// .:[Bake]:.
+//          >> Each row starts from the border distance and then only takes the segments whose box, grown by
+//          >> the range, covers it, and within those only the columns inside the box. Rows write only their
+//          >> own slice of the grid, so they split across the thread pool without locks
+void CollisionField::bake(const vector<vector<Vector2f>>& outlines, Vector2u windowSize, ThreadPool& threadPool)
+{
+	struct Segment
+	{
+		Vector2f start;
+		Vector2f direction;
+		float lengthSquared;
+		FloatRect reach;                // Box around the segment grown by the range
+	};
+	const float reach = COLLISION_RANGE + WALL_THICKNESS;
+	vector<Segment> segments;
+	for (const vector<Vector2f>& outline : outlines)
+	{
+		for (size_t i = 0; i + 1 < outline.size(); i++)
+		{
+			Vector2f a = outline[i];
+			Vector2f b = outline[i + 1];
+			Vector2f direction = b - a;
+			FloatRect box(min(a.x, b.x) - reach, min(a.y, b.y) - reach, fabsf(direction.x) + 2 * reach, fabsf(direction.y) + 2 * reach);
+			segments.push_back({ a, direction, direction.x * direction.x + direction.y * direction.y, box });
+		}
+	}
+
+	m_size = Vector2f(windowSize);
+	m_columns = (int)ceil(m_size.x / COLLISION_CELL) + 1;
+	m_rows = (int)ceil(m_size.y / COLLISION_CELL) + 1;
+	m_distances.resize((size_t)m_columns * m_rows);
+
+	threadPool.parallelFor(m_rows, [&](int begin, int end)
+	{
+		for (int row = begin; row < end; row++)
+		{
+			float y = row * COLLISION_CELL;
+			float* distances = &m_distances[(size_t)row * m_columns];
+			for (int column = 0; column < m_columns; column++)
+			{
+				distances[column] = min(borderDistance(Vector2f(column * COLLISION_CELL, y)), COLLISION_RANGE);
+			}
+
+			for (const Segment& segment : segments)
+			{
+				if (y < segment.reach.top || y > segment.reach.top + segment.reach.height)
+				{
+					continue;
+				}
+				int first = max(0, (int)ceil(segment.reach.left / COLLISION_CELL));
+				int last = min(m_columns - 1, (int)floor((segment.reach.left + segment.reach.width) / COLLISION_CELL));
+				for (int column = first; column <= last; column++)
+				{
+					Vector2f offset = Vector2f(column * COLLISION_CELL, y) - segment.start;
+					float t = 0.0f;
+					if (segment.lengthSquared > 0.0f)
+					{
+						t = (offset.x * segment.direction.x + offset.y * segment.direction.y) / segment.lengthSquared;
+						t = max(0.0f, min(1.0f, t));
+					}
+					Vector2f closest = offset - segment.direction * t;
+					distances[column] = min(distances[column], sqrtf(closest.x * closest.x + closest.y * closest.y) - WALL_THICKNESS);
+				}
+			}
+		}
+	});
+}
+
+float CollisionField::sample(Vector2f pixel) const
+{
+	if (pixel.x < 0.0f || pixel.y < 0.0f || pixel.x > m_size.x || pixel.y > m_size.y)
+	{
+		return borderDistance(pixel);
+	}
+
+	float gx = pixel.x / COLLISION_CELL;
+	float gy = pixel.y / COLLISION_CELL;
+	int x0 = min((int)gx, m_columns - 2);
+	int y0 = min((int)gy, m_rows - 2);
+	float fx = gx - x0;
+	float fy = gy - y0;
+	const float* top = &m_distances[(size_t)y0 * m_columns + x0];
+	const float* bottom = top + m_columns;
+	float upper = top[0] + (top[1] - top[0]) * fx;
+	float lower = bottom[0] + (bottom[1] - bottom[0]) * fx;
+	return upper + (lower - upper) * fy;
+}
+
+// .:[Collision Response]:.
+//          >> Walls are thinner than a fast particle's step, so the step is sphere-traced from the old center:
+//          >> each march moves by the distance to the nearest wall, which can't skip one, and never less than
+//          >> half a cell. In open space the first sample already covers the whole step.
+//          >> The wall normal comes from central differences one cell apart. Particle coordinates have y up,
+//          >> pixels y down, so y flips on the way back out
+void CollisionField::collide(Particle& particle, Vector2f previousCenter, float dt) const
+{
+	Vector2f from = toPixel(previousCenter);
+	Vector2f to = toPixel(particle.getCenter());
+	Vector2f travel = to - from;
+	float length = sqrtf(travel.x * travel.x + travel.y * travel.y);
+
+	Vector2f hit = from;
+	float distance = sample(from);
+	float t = 0.0f;
+	while (distance >= 0.0f && t < length)
+	{
+		t = min(length, t + max(distance, COLLISION_CELL * 0.5f));
+		hit = from + travel * (t / length);
+		distance = sample(hit);
+	}
+	if (distance >= 0.0f)
+	{
+		return;
+	}
+
+	float nx = sample(hit + Vector2f(COLLISION_CELL, 0.0f)) - sample(hit - Vector2f(COLLISION_CELL, 0.0f));
+	float ny = sample(hit + Vector2f(0.0f, COLLISION_CELL)) - sample(hit - Vector2f(0.0f, COLLISION_CELL));
+	float normalLength = sqrtf(nx * nx + ny * ny);
+	if (normalLength <= 0.0f)
+	{
+		return;
+	}
+	nx /= normalLength;
+	ny /= normalLength;
+
+	Vector2f surface = hit - Vector2f(nx, ny) * distance;
+	particle.displace(surface.x - to.x, to.y - surface.y);
+
+	Vector2f velocity = particle.getVelocity();
+	float into = velocity.x * nx - velocity.y * ny;
+	if (into < 0.0f && dt > 0.0f)
+	{
+		float bounce = -(1.0f + RESTITUTION) * into / dt;
+		particle.accelerate(bounce * nx, -bounce * ny, dt);
+	}
+}
+
+float CollisionField::borderDistance(Vector2f pixel) const
+{
+	return min(min(pixel.x, m_size.x - pixel.x), min(pixel.y, m_size.y - pixel.y));
+}
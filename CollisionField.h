@@ -0,0 +1,45 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Particle.h"
+#include "ThreadPool.h"
+
+using namespace sf;
+using namespace std;
+
+// .:[Collision Field]:.
+//          >> Signed distance to static scene geometry, baked once into a grid with a node every
+//          >> COLLISION_CELL pixels and sampled bilinearly, so a collision test costs the same however many
+//          >> segments the scene has. Positive is free space, negative is inside a wall. Distances are exact
+//          >> up to COLLISION_RANGE and clamped there, which is all a step ever needs, so the bake only visits
+//          >> the nodes near each segment.
+//          >> Walls are the window borders plus outlines, each outline a polyline treated as a wall
+//          >> WALL_THICKNESS pixels either side of its segments, so open and self-crossing curves work too.
+//          >> Everything here is in window pixels, y down; collide() converts from particle coordinates.
+const float COLLISION_CELL = 4.0f;
+const float WALL_THICKNESS = 4.0f;
+const float COLLISION_RANGE = 64.0f;
+
+class CollisionField
+{
+public:
+    ///Bake distances for a window of this size; rows are spread over the thread pool
+    void bake(const vector<vector<Vector2f>>& outlines, Vector2u windowSize, ThreadPool& threadPool);
+    bool isBaked() const { return !m_distances.empty(); }
+
+    ///Bilinear distance; off the grid it falls back to the exact distance to the window borders
+    float sample(Vector2f pixel) const;
+
+    ///Check a particle's last step, from previousCenter to where it is now, against the walls. On a hit it is
+    ///put back on the wall's surface, the velocity component into the wall bounces and the sliding one is kept
+    void collide(Particle& particle, Vector2f previousCenter, float dt) const;
+
+private:
+    vector<float> m_distances;          // m_columns x m_rows nodes, row-major
+    int m_columns = 0;
+    int m_rows = 0;
+    Vector2f m_size;
+
+    float borderDistance(Vector2f pixel) const;
+    Vector2f toPixel(Vector2f coordinate) const { return Vector2f(coordinate.x + m_size.x * 0.5f, m_size.y * 0.5f - coordinate.y); }
+};
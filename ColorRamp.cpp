@@ -0,0 +1,49 @@
+#include "ColorRamp.h"
+#include <algorithm>
+
+ColorRamp::ColorRamp()
+{
+	fill(m_table, m_table + RAMP_SIZE, Color::White);
+}
+
+// .:[Ramp Baking]:.
+//          >> Each entry interpolates linearly between the keys around its life value
+ColorRamp::ColorRamp(vector<ColorKey> keys)
+{
+	if (keys.empty())
+	{
+		fill(m_table, m_table + RAMP_SIZE, Color::White);
+		return;
+	}
+	sort(keys.begin(), keys.end(), [](const ColorKey& a, const ColorKey& b) { return a.life < b.life; });
+
+	size_t next = 0;
+	for (int i = 0; i < RAMP_SIZE; i++)
+	{
+		float life = i / (float)(RAMP_SIZE - 1);
+		while (next < keys.size() && keys[next].life < life)
+		{
+			++next;
+		}
+
+		if (next == 0)
+		{
+			m_table[i] = keys.front().tint;
+		}
+		else if (next == keys.size())
+		{
+			m_table[i] = keys.back().tint;
+		}
+		else
+		{
+			const ColorKey& a = keys[next - 1];
+			const ColorKey& b = keys[next];
+			float t = (life - a.life) / (b.life - a.life);
+			m_table[i] = Color(
+				(Uint8)(a.tint.r + (b.tint.r - a.tint.r) * t + 0.5f),
+				(Uint8)(a.tint.g + (b.tint.g - a.tint.g) * t + 0.5f),
+				(Uint8)(a.tint.b + (b.tint.b - a.tint.b) * t + 0.5f),
+				(Uint8)(a.tint.a + (b.tint.a - a.tint.a) * t + 0.5f));
+		}
+	}
+}
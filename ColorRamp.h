@@ -0,0 +1,37 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+using namespace sf;
+using namespace std;
+
+const int RAMP_SIZE = 64;               // Table entries per ramp; one entry covers 1/63 of a lifetime
+
+// .:[Color Key]:.
+struct ColorKey
+{
+    float life;                         // 0 at spawn, 1 at expiry
+    Color tint;                         // Multiplied into the particle's own colors; alpha fades it
+};
+
+// .:[Color Ramp]:.
+//          >> Color-over-life curve, baked once into a lookup table so applying it each frame is
+//          >> one multiply, one table read and a compare per particle
+class ColorRamp
+{
+public:
+    ///Plain white: leaves colors untouched
+    ColorRamp();
+
+    ///Keys may be in any order; the ramp holds the first and last key's tint beyond them
+    explicit ColorRamp(vector<ColorKey> keys);
+
+    const Color& sample(float life) const
+    {
+        int index = (int)(life * (RAMP_SIZE - 1) + 0.5f);
+        return m_table[(index < 0) ? 0 : (index >= RAMP_SIZE) ? RAMP_SIZE - 1 : index];
+    }
+
+private:
+    Color m_table[RAMP_SIZE];
+};
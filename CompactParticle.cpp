@@ -0,0 +1,351 @@
+#include "CompactParticle.h"
+#include "FastMath.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+const float TURNS_PER_RADIAN = 65536.0f / (2.0f * (float)M_PI);
+const float TILE_ORIGIN = -0.5f * COMPACT_TILE_SIZE * COMPACT_TILES;     // Cartesian corner of tile 0
+const float GROW_RATE = 1.002f;             // GrowParticle's default growScale
+const float GROW_LIMIT = 0.3f;              // Growth GrowParticle::update() stops at
+const float WAVE_AMPLITUDE = 1500.0f;       // Pixels per second; a sine standing in for WaveParticle's bang-bang oscillator
+const float WAVE_RATE = 0.7f;               // Radians per second of age, about the oscillator's nine second period
+const float WAVE_SPEED = 10.0f;             // WaveParticle's default oscillator acceleration and width, for saved states
+const float WAVE_WIDTH = 15000.0f;
+const int PARTICLE_GRAIN = 2048;            // Particles per job
+const int FAN_VERTICES = 3 * (COMPACT_POINTS - 1);
+
+// .:[Hash]:.
+//          >> Integer finalizer; cheap, stateless randomness that every thread agrees on
+static uint32_t hashBits(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352D;
+	x ^= x >> 15;
+	x *= 0x846CA68B;
+	x ^= x >> 16;
+	return x;
+}
+
+// .:[Position Packing]:.
+//          >> One 24-bit fixed-point number per axis: the top 4 bits are the tile, the low 16 the position inside it
+static bool encodePosition(float x, float y, CompactParticle& particle)
+{
+	const float limit = (float)(COMPACT_TILES << 16);
+	float fx = (x - TILE_ORIGIN) * 256.0f;
+	float fy = (y - TILE_ORIGIN) * 256.0f;
+	if (!(fx >= 0.0f && fy >= 0.0f && fx < limit - 1.0f && fy < limit - 1.0f))
+	{
+		return false;
+	}
+	uint32_t ix = (uint32_t)(fx + 0.5f);
+	uint32_t iy = (uint32_t)(fy + 0.5f);
+	particle.x = (uint16_t)ix;
+	particle.y = (uint16_t)iy;
+	particle.tile = (uint8_t)((ix >> 16) | ((iy >> 16) << 4));
+	return true;
+}
+
+static Vector2f decodePosition(const CompactParticle& particle)
+{
+	uint32_t ix = ((uint32_t)(particle.tile & 0x0F) << 16) | particle.x;
+	uint32_t iy = ((uint32_t)(particle.tile >> 4) << 16) | particle.y;
+	return Vector2f(ix * (1.0f / 256.0f) + TILE_ORIGIN, iy * (1.0f / 256.0f) + TILE_ORIGIN);
+}
+
+// .:[Constructor]:.
+//          >> The bank is built the way Particle builds its fans, radii 20 to 80 around evenly spaced angles, but
+//          >> from its own fixed seed so it never consumes rand() and sessions still replay exactly
+CompactSwarm::CompactSwarm(ThreadPool& threadPool)
+	: m_threadPool(threadPool), m_shapes(COMPACT_SHAPES * COMPACT_POINTS)
+{
+	minstd_rand random(COMPACT_SHAPES);
+	uniform_real_distribution<float> radii(20.0f, 80.0f);
+	const float step = 2.0f * (float)M_PI / (COMPACT_POINTS - 1);
+	for (int shape = 0; shape < COMPACT_SHAPES; shape++)
+	{
+		Vector2f* points = &m_shapes[shape * COMPACT_POINTS];
+		float total = 0.0f;
+		for (int j = 0; j < COMPACT_POINTS; j++)
+		{
+			float radius = radii(random);
+			points[j] = Vector2f(radius * cosf(j * step), radius * sinf(j * step));
+			total += radius;
+		}
+		float normalize = COMPACT_POINTS / total;
+		for (int j = 0; j < COMPACT_POINTS; j++)
+		{
+			points[j] *= normalize;
+		}
+	}
+}
+
+// .:[Encode]:.
+//          >> The fan keeps its mean radius and the direction of its first rim point; the bank shape
+//          >> supplies the rest
+bool CompactSwarm::add(const ParticleState& state)
+{
+	CompactParticle particle = {};
+	if (state.ttl <= 0.0f || !encodePosition(state.centerX, state.centerY, particle))
+	{
+		return false;
+	}
+	particle.color1 = state.color1;
+	particle.color2 = state.color2;
+	bool wave = (state.type == WAVE);
+	particle.vx = floatToHalf(wave ? state.wave.globalVelocityX : state.vx);
+	particle.vy = floatToHalf(wave ? state.wave.globalVelocityY : state.vy);
+
+	int numPoints = min((int)state.numPoints, MAX_POINTS);
+	float radius = 0.0f;
+	for (int j = 0; j < numPoints; j++)
+	{
+		float dx = state.points[j][0] - state.centerX;
+		float dy = state.points[j][1] - state.centerY;
+		radius += sqrtf(dx * dx + dy * dy);
+	}
+	particle.scale = floatToHalf(numPoints > 0 ? radius / numPoints : 0.0f);
+	if (numPoints > 0)
+	{
+		float first = atan2f(state.points[0][1] - state.centerY, state.points[0][0] - state.centerX);
+		particle.angle = (uint16_t)(int32_t)lroundf(first * TURNS_PER_RADIAN);
+	}
+	particle.spin = floatToHalf(state.radiansPerSec);
+
+	particle.lifetime = (uint8_t)min(255L, lroundf(state.lifetime * 4.0f));
+	particle.life = (state.lifetime > 0.0f) ? (uint8_t)max(1L, min(255L, lroundf(255.0f * state.ttl / state.lifetime))) : 1;
+	particle.type = state.type;
+	particle.shape = (uint8_t)hashBits(m_added++);
+	if (wave)
+	{
+		particle.shape = (particle.shape & ~1) | (state.wave.directionX & 1);
+	}
+	if (state.type == GROW && state.scaleMultiplier > 1.0f && state.grow.growAmount < GROW_LIMIT)
+	{
+		float steps = floorf((GROW_LIMIT - state.grow.growAmount) / (state.scaleMultiplier - 1.0f));
+		particle.growSteps = (uint8_t)min(255.0f, steps);
+	}
+
+	m_particles.push_back(particle);
+	m_typeCounts[particle.type]++;
+	return true;
+}
+
+// .:[Swap Remove]:.
+void CompactSwarm::remove(size_t index)
+{
+	m_typeCounts[m_particles[index].type]--;
+	m_particles[index] = m_particles.back();
+	m_particles.pop_back();
+}
+
+void CompactSwarm::expire()
+{
+	for (size_t i = m_particles.size(); i-- > 0; )
+	{
+		if (m_particles[i].life == 0)
+		{
+			remove(i);
+		}
+	}
+}
+
+// .:[Cull]:.
+//          >> Order means nothing here, so the least-lived particles are partitioned to the back and popped
+void CompactSwarm::cull(size_t count)
+{
+	count = min(count, m_particles.size());
+	if (count == 0)
+	{
+		return;
+	}
+	nth_element(m_particles.begin(), m_particles.end() - count, m_particles.end(),
+		[](const CompactParticle& a, const CompactParticle& b) { return a.life > b.life; });
+	while (count-- > 0)
+	{
+		m_typeCounts[m_particles.back().type]--;
+		m_particles.pop_back();
+	}
+}
+
+// >> The dithering and shape counters restart too, so a cleared swarm behaves exactly like a new one
+void CompactSwarm::clear()
+{
+	m_particles.clear();
+	fill(m_typeCounts, m_typeCounts + GROW + 1, 0);
+	m_step = 0;
+	m_added = 0;
+}
+
+Vector2f CompactSwarm::getCenter(size_t index) const
+{
+	return decodePosition(m_particles[index]);
+}
+
+Vector2f CompactSwarm::getVelocity(size_t index) const
+{
+	return Vector2f(halfToFloat(m_particles[index].vx), halfToFloat(m_particles[index].vy));
+}
+
+// .:[Decode]:.
+//          >> The full state nearest to what is stored: the bank shape rotated and scaled into COMPACT_POINTS rim
+//          >> points, life back into seconds, and the fields add() drops filled with the spawn defaults. A wave
+//          >> restarts its oscillator, since the compact kernel never tracked one
+void CompactSwarm::saveState(size_t index, ParticleState& state) const
+{
+	const CompactParticle& particle = m_particles[index];
+	state = ParticleState();
+	state.type = particle.type;
+	state.numPoints = COMPACT_POINTS;
+	state.lifetime = particle.lifetime * 0.25f;
+	state.ttl = particle.life * (1.0f / 255.0f) * state.lifetime;
+	state.radiansPerSec = halfToFloat(particle.spin);
+	state.vx = halfToFloat(particle.vx);
+	state.vy = halfToFloat(particle.vy);
+	state.color1 = particle.color1;
+	state.color2 = particle.color2;
+
+	Vector2f center = decodePosition(particle);
+	state.centerX = center.x;
+	state.centerY = center.y;
+	float angle = particle.angle * (1.0f / TURNS_PER_RADIAN);
+	float scale = halfToFloat(particle.scale);
+	float sine = sinf(angle) * scale;
+	float cosine = cosf(angle) * scale;
+	const Vector2f* shape = &m_shapes[particle.shape * COMPACT_POINTS];
+	for (int j = 0; j < COMPACT_POINTS; j++)
+	{
+		state.points[j][0] = center.x + shape[j].x * cosine - shape[j].y * sine;
+		state.points[j][1] = center.y + shape[j].x * sine + shape[j].y * cosine;
+	}
+
+	state.scaleMultiplier = (particle.type == NORMAL) ? SCALE : 1.0f;
+	if (particle.type == WAVE)
+	{
+		state.wave.speed = WAVE_SPEED;
+		state.wave.widthX = WAVE_WIDTH;
+		state.wave.globalVelocityX = state.vx;
+		state.wave.globalVelocityY = state.vy;
+		state.wave.directionX = particle.shape & 1;
+	}
+	else if (particle.type == GROW)
+	{
+		state.scaleMultiplier = (particle.growSteps > 0) ? GROW_RATE : 1.0f;
+		state.grow.growAmount = max(0.0f, GROW_LIMIT - particle.growSteps * (GROW_RATE - 1.0f));
+		state.grow.maxGrow = GROW_LIMIT;
+	}
+}
+
+void CompactSwarm::accelerate(size_t index, float ax, float ay, float dt)
+{
+	CompactParticle& particle = m_particles[index];
+	particle.vx = floatToHalf(halfToFloat(particle.vx) + ax * dt);
+	particle.vy = floatToHalf(halfToFloat(particle.vy) + ay * dt);
+}
+
+// .:[Update Kernel]:.
+//          >> Mirrors Particle::transformUpdate(): only growing particles change size, and waves add their
+//          >> oscillation on top of the stored velocity without storing it, since it only depends on age.
+//          >> A step usually uses up less than one unit of life, so the fraction is rounded up with a
+//          >> probability equal to it; the expected lifetime stays exact
+void CompactSwarm::update(float dt)
+{
+	uint32_t seed = hashBits(++m_step);
+	m_threadPool.parallelFor((int)m_particles.size(), [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			CompactParticle& particle = m_particles[i];
+			if (particle.life == 0)
+			{
+				continue;
+			}
+
+			Vector2f center = decodePosition(particle);
+			float vx = halfToFloat(particle.vx);
+			float vy = halfToFloat(particle.vy);
+			float lifetime = particle.lifetime * 0.25f;
+			if (particle.type == WAVE)
+			{
+				float age = (1.0f - particle.life * (1.0f / 255.0f)) * lifetime;
+				float wave = WAVE_AMPLITUDE * fastSin(WAVE_RATE * age);
+				vx += (particle.shape & 1) ? wave : -wave;
+			}
+			if (!encodePosition(center.x + vx * dt, center.y + vy * dt, particle))
+			{
+				particle.life = 0;
+				continue;
+			}
+
+			particle.angle += (uint16_t)(int32_t)lroundf(halfToFloat(particle.spin) * dt * TURNS_PER_RADIAN);
+			if (particle.type == GROW && particle.growSteps > 0)
+			{
+				particle.scale = floatToHalf(halfToFloat(particle.scale) * GROW_RATE * (1.0f + dt));
+				particle.growSteps--;
+			}
+
+			float used = (lifetime > 0.0f) ? dt * 255.0f / lifetime : 255.0f;
+			int whole = (int)used;
+			if ((hashBits(seed ^ (uint32_t)i) >> 8) * (1.0f / 16777216.0f) < used - whole)
+			{
+				whole++;
+			}
+			particle.life = (whole >= particle.life) ? 0 : (uint8_t)(particle.life - whole);
+		}
+	}, PARTICLE_GRAIN);
+}
+
+// .:[Draw Kernel]:.
+//          >> Each particle writes its own fixed-size stretch of the vertex array, a triangle list in the same
+//          >> layout ParticleBatch uses, so jobs never overlap. Particles that died this step still draw,
+//          >> as heap particles do on their last frame
+void CompactSwarm::prepare(const RenderTarget& target, const ColorRamp* ramps)
+{
+	if (m_particles.empty())
+	{
+		m_vertices.clear();
+		return;
+	}
+	m_vertices.resize(m_particles.size() * FAN_VERTICES);
+	Vector2f half = Vector2f(target.getSize()) * 0.5f;
+	m_threadPool.parallelFor((int)m_particles.size(), [&](int begin, int end)
+	{
+		Vector2f rim[COMPACT_POINTS];
+		for (int i = begin; i < end; i++)
+		{
+			const CompactParticle& particle = m_particles[i];
+			Vector2f center = decodePosition(particle);
+			center = Vector2f(half.x + center.x, half.y - center.y);
+			float sine, cosine;
+			fastSinCos(particle.angle * (1.0f / TURNS_PER_RADIAN), sine, cosine);
+			float scale = halfToFloat(particle.scale);
+			sine *= scale;
+			cosine *= scale;
+
+			const Vector2f* shape = &m_shapes[particle.shape * COMPACT_POINTS];
+			for (int j = 0; j < COMPACT_POINTS; j++)
+			{
+				rim[j] = Vector2f(center.x + shape[j].x * cosine - shape[j].y * sine, center.y - (shape[j].x * sine + shape[j].y * cosine));
+			}
+
+			const Color& tint = ramps[particle.type].sample(1.0f - particle.life * (1.0f / 255.0f));
+			Color inner = Color(particle.color1) * tint;
+			Color outer = Color(particle.color2) * tint;
+			Vertex* out = &m_vertices[(size_t)i * FAN_VERTICES];
+			for (int j = 1; j < COMPACT_POINTS; j++)
+			{
+				*out++ = Vertex(center, inner);
+				*out++ = Vertex(rim[j - 1], outer);
+				*out++ = Vertex(rim[j], outer);
+			}
+		}
+	}, PARTICLE_GRAIN / 8);
+}
+
+void CompactSwarm::draw(RenderTarget& target) const
+{
+	if (!m_vertices.empty())
+	{
+		target.draw(m_vertices.data(), m_vertices.size(), Triangles);
+	}
+}
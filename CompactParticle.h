@@ -0,0 +1,94 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Particle.h"
+#include "ColorRamp.h"
+#include "ThreadPool.h"
+
+using namespace sf;
+using namespace std;
+
+const int COMPACT_TILE_SIZE = 256;                  // Pixels per tile side; positions are 8.8 fixed point inside one
+const int COMPACT_TILES = 16;                       // Tiles per axis, centered on the window: +-2048 pixels
+const int COMPACT_SHAPES = 256;                     // Fans in the shared shape bank
+const int COMPACT_POINTS = 25;                      // Rim points of every bank shape; the fewest the engine spawns
+
+// .:[Compact Particle]:.
+//          >> 28 bytes in place of a heap Particle's several hundred plus its Matrix. The fan is a shape bank
+//          >> index with a rotation and a mean radius instead of its own points; floats are fixed point or halves.
+//          >> Only the kernels in CompactSwarm decode and re-encode it.
+struct CompactParticle
+{
+    uint32_t color1, color2;            // Packed RGBA, see Color::toInteger()
+    uint16_t x, y;                      // 8.8 fixed-point pixels inside the tile; Cartesian, y up
+    uint16_t vx, vy;                    // Half floats, pixels per second; for waves, the velocity the wave rides on
+    uint16_t angle;                     // Rotation in 1/65536 turns
+    uint16_t spin;                      // Half float, radians per second
+    uint16_t scale;                     // Half float, mean rim radius in pixels
+    uint8_t tile;                       // Column in the low nibble, row in the high nibble
+    uint8_t life;                       // Share of the lifetime left, 255 at spawn; 0 once dead
+    uint8_t lifetime;                   // Quarter seconds
+    uint8_t type;                       // ParticleType
+    uint8_t shape;                      // Bank index; for waves the low bit is also the wave's starting direction
+    uint8_t growSteps;                  // Steps a GROW particle has left to grow
+};
+
+static_assert(sizeof(CompactParticle) < 32, "Compact particles must stay under 32 bytes");
+
+// .:[Compact Swarm]:.
+//          >> Optional store for bandwidth-bound scenes: particles are encoded from a ParticleState on the way in
+//          >> and live as CompactParticles from then on. update() and draw() are parallel kernels over the
+//          >> packed array, decoding into registers and encoding back, so every step streams 28 bytes per
+//          >> particle instead of chasing heap objects.
+//          >> Lossy by design: rim points snap to a bank shape of the same mean radius, positions to 1/256 pixel,
+//          >> velocities and sizes to half precision, and life to 1/255 of the lifetime, which counts down with
+//          >> dithered rounding so short steps still add up. Particles leaving the tiles are dropped.
+class CompactSwarm
+{
+public:
+    explicit CompactSwarm(ThreadPool& threadPool);
+
+    ///Encode a particle; returns false for one that is already dead or outside the tiles
+    bool add(const ParticleState& state);
+
+    ///Drop every particle that died during the last update(); call at the start of a step
+    void expire();
+
+    ///Drop the count particles with the least life left
+    void cull(size_t count);
+    void clear();
+
+    ///Move, spin, grow and age every particle by dt
+    void update(float dt);
+
+    ///Tint by life from ramps, indexed by ParticleType, into the vertex array; call between steps
+    void prepare(const RenderTarget& target, const ColorRamp* ramps);
+
+    ///Draw every particle from the last prepare() in one call
+    void draw(RenderTarget& target) const;
+
+    ///Decoded state for the force field pass
+    Vector2f getCenter(size_t index) const;
+    Vector2f getVelocity(size_t index) const;
+    ParticleType getType(size_t index) const { return (ParticleType)m_particles[index].type; }
+    void accelerate(size_t index, float ax, float ay, float dt);
+
+    ///Decode a particle into the full state a snapshot saves; add() of the result gives the same particle back,
+    ///up to the shape it picks from the bank
+    void saveState(size_t index, ParticleState& state) const;
+
+    size_t size() const { return m_particles.size(); }
+    size_t getTypeCount(ParticleType type) const { return m_typeCounts[type]; }
+
+private:
+    ThreadPool& m_threadPool;
+    vector<CompactParticle> m_particles;
+    vector<Vector2f> m_shapes;          // COMPACT_POINTS rim points per shape around the origin, mean radius 1
+    vector<Vertex> m_vertices;
+    size_t m_typeCounts[GROW + 1] = {};
+    uint32_t m_step = 0;                // Seeds the life dithering
+    uint32_t m_added = 0;               // Picks bank shapes
+
+    void remove(size_t index);
+};
@@ -0,0 +1,194 @@
+#include "DustCloud.h"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const size_t DUST_MASK = DUST_CAPACITY - 1;
+const float DUST_GRAVITY = 200.0f;          // Pixels per second squared; dust is light next to fan particles
+const float DUST_DRAG = 1.5f;               // Per second; terminal velocity is gravity over drag
+const float DUST_SPEED = 600.0f;            // Spread of spray velocities
+const int DUST_GRAIN = 16384;               // Grains per update job
+const int VERTEX_GRAIN = 8192;              // Grains per vertex job
+
+DustCloud::DustCloud(ThreadPool& threadPool)
+	: m_threadPool(threadPool), m_x(DUST_CAPACITY), m_y(DUST_CAPACITY), m_vx(DUST_CAPACITY), m_vy(DUST_CAPACITY),
+	m_birth(DUST_CAPACITY), m_color(DUST_CAPACITY), m_buffer(Points, VertexBuffer::Stream)
+{
+}
+
+// .:[Random]:.
+//          >> xorshift32 into [0, 1)
+float DustCloud::nextRandom()
+{
+	m_random ^= m_random << 13;
+	m_random ^= m_random >> 17;
+	m_random ^= m_random << 5;
+	return (m_random >> 8) * (1.0f / 16777216.0f);
+}
+
+void DustCloud::push(Vector2f position, Vector2f velocity, Color color, float birth)
+{
+	m_x[m_head] = position.x;
+	m_y[m_head] = position.y;
+	m_vx[m_head] = velocity.x;
+	m_vy[m_head] = velocity.y;
+	m_birth[m_head] = birth;
+	m_color[m_head] = color;
+	m_head = (m_head + 1) & DUST_MASK;
+	m_count = min(m_count + 1, (size_t)DUST_CAPACITY);
+}
+
+// .:[Spawn]:.
+//          >> The epoch restarts whenever the cloud is empty, so birth times stay small
+void DustCloud::spawn(Vector2f center, int count, double now)
+{
+	if (m_count == 0)
+	{
+		m_epoch = now;
+	}
+	float birth = (float)(now - m_epoch);
+	for (int i = 0; i < count; i++)
+	{
+		Vector2f velocity((nextRandom() - 0.5f) * DUST_SPEED, (0.3f + 0.7f * nextRandom()) * DUST_SPEED);
+		Color color((Uint8)(128 + 127 * nextRandom()), (Uint8)(128 + 127 * nextRandom()), (Uint8)(128 + 127 * nextRandom()), 200);
+		push(center, velocity, color, birth);
+	}
+}
+
+void DustCloud::scatter(Vector2f area, int count, double now)
+{
+	if (m_count == 0)
+	{
+		m_epoch = now;
+	}
+	float birth = (float)(now - m_epoch);
+	for (int i = 0; i < count; i++)
+	{
+		Vector2f position((nextRandom() - 0.5f) * area.x, (nextRandom() - 0.5f) * area.y);
+		Vector2f velocity((nextRandom() - 0.5f) * 60.0f, (nextRandom() - 0.5f) * 60.0f);
+		Uint8 shade = (Uint8)(150 + 105 * nextRandom());
+		push(position, velocity, Color(shade, shade, 255, 160), birth - DUST_TTL * nextRandom());
+	}
+}
+
+// .:[Spans]:.
+//          >> Splits the live grains into jobs by logical index (0 is the oldest) and hands each job the physical
+//          >> runs it covers; a job straddling the end of the ring gets two
+void DustCloud::forSpans(const function<void(size_t first, size_t logical, int count)>& job, int grain)
+{
+	size_t oldest = tail();
+	m_threadPool.parallelFor((int)m_count, [&](int begin, int end)
+	{
+		size_t first = (oldest + begin) & DUST_MASK;
+		int run = (int)min((size_t)(end - begin), DUST_CAPACITY - first);
+		job(first, begin, run);
+		if (begin + run < end)
+		{
+			job(0, begin + run, end - begin - run);
+		}
+	}, grain);
+}
+
+// .:[Integrate]:.
+//          >> Drag, gravity and the move for one contiguous run, four grains per instruction where SSE2 is
+//          >> available. Drag is applied as a per-step factor so a long step can't reverse a grain
+static void integrateRun(float* x, float* y, float* vx, float* vy, int count, float dt, float keep, float fall)
+{
+	int i = 0;
+#ifdef __SSE2__
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 drag = _mm_set1_ps(keep);
+	const __m128 gravity = _mm_set1_ps(fall);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 u = _mm_mul_ps(_mm_loadu_ps(vx + i), drag);
+		__m128 v = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(vy + i), drag), gravity);
+		_mm_storeu_ps(vx + i, u);
+		_mm_storeu_ps(vy + i, v);
+		_mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(u, step)));
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(v, step)));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		vx[i] *= keep;
+		vy[i] = vy[i] * keep - fall;
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+	}
+}
+
+void DustCloud::update(float dt, double now)
+{
+	float age = (float)(now - m_epoch);
+	while (m_count > 0 && age - m_birth[tail()] >= DUST_TTL)
+	{
+		m_count--;
+	}
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	float keep = expf(-DUST_DRAG * dt);
+	float fall = DUST_GRAVITY * dt;
+	forSpans([&](size_t first, size_t, int count)
+	{
+		integrateRun(&m_x[first], &m_y[first], &m_vx[first], &m_vy[first], count, dt, keep, fall);
+	}, DUST_GRAIN);
+}
+
+// .:[Draw Kernel]:.
+//          >> One point per grain, written in logical order so the oldest draw first and the newest on top
+void DustCloud::prepare(const RenderTarget& target, double now)
+{
+	m_drawCount = m_count;
+	if (m_count == 0)
+	{
+		return;
+	}
+	m_vertices.resize(m_count);
+	Vector2f half = Vector2f(target.getSize()) * 0.5f;
+	float age = (float)(now - m_epoch);
+	forSpans([&](size_t first, size_t logical, int count)
+	{
+		Vertex* out = &m_vertices[logical];
+		for (int i = 0; i < count; i++)
+		{
+			size_t grain = first + i;
+			float fade = 1.0f - (age - m_birth[grain]) * (1.0f / DUST_TTL);
+			Color color = m_color[grain];
+			color.a = (Uint8)(color.a * max(0.0f, min(1.0f, fade)));
+			out[i] = Vertex(Vector2f(half.x + m_x[grain], half.y - m_y[grain]), color);
+		}
+	}, VERTEX_GRAIN);
+
+	if (!VertexBuffer::isAvailable())
+	{
+		return;
+	}
+	if (m_count > m_capacity)
+	{
+		m_capacity = min(max(m_count, m_capacity * 2), (size_t)DUST_CAPACITY);
+		m_buffer.create(m_capacity);
+	}
+	m_buffer.update(m_vertices.data(), m_count, 0);
+}
+
+void DustCloud::draw(RenderTarget& target) const
+{
+	if (m_drawCount == 0)
+	{
+		return;
+	}
+	if (VertexBuffer::isAvailable())
+	{
+		target.draw(m_buffer, 0, m_drawCount);
+	}
+	else
+	{
+		target.draw(m_vertices.data(), m_drawCount, Points);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.h"
+
+using namespace sf;
+using namespace std;
+
+const int DUST_CAPACITY = 1 << 20;      // Most live dust; spawning past it replaces the oldest
+const float DUST_TTL = 8.0f;            // Seconds every grain lives
+
+// .:[Dust Cloud]:.
+//          >> Lightweight particles with no shape: position, velocity, color and birth time in separate arrays,
+//          >> drawn as one sf::Points vertex each from a single buffer. A million of them cost 24 bytes each.
+//          >> Every grain lives exactly DUST_TTL, so they die in the order they were born and the arrays are a
+//          >> ring: expiry just moves the tail up past the dead, and nothing is ever swapped or compacted.
+//          >> A grain born out of order (scatter() back-dates them) only waits for the tail to reach it; it is
+//          >> already invisible, since alpha fades to zero with age.
+//          >> Updating is one straight-line pass (drag, gravity, move) that runs four grains at a time with SSE2,
+//          >> and both it and vertex generation are split across the thread pool.
+//          >> Positions are Cartesian like particle centers: origin mid-window, y up.
+class DustCloud
+{
+public:
+    explicit DustCloud(ThreadPool& threadPool);
+
+    ///count grains at center, sprayed upward like fan particles, with random bright colors
+    void spawn(Vector2f center, int count, double now);
+
+    ///count grains scattered over an area centered on the origin, drifting slowly, with ages spread over DUST_TTL
+    void scatter(Vector2f area, int count, double now);
+
+    ///Drop grains older than DUST_TTL, then move the rest by dt
+    void update(float dt, double now);
+
+    ///Fade by age into the vertex buffer; call between steps, since it reads the grains
+    void prepare(const RenderTarget& target, double now);
+
+    ///Draw every grain from the last prepare() in one call
+    void draw(RenderTarget& target) const;
+
+    void clear() { m_count = 0; }
+    size_t size() const { return m_count; }
+
+private:
+    ThreadPool& m_threadPool;
+    vector<float> m_x, m_y, m_vx, m_vy;
+    vector<float> m_birth;              // Simulated time, relative to m_epoch so float keeps enough precision
+    vector<Color> m_color;
+    size_t m_head = 0;                  // Next slot to write
+    size_t m_count = 0;
+    double m_epoch = -1.0;
+    uint32_t m_random = 0x9E3779B9;     // xorshift state; dust never touches rand(), so it can't shift a replay
+
+    VertexBuffer m_buffer;
+    size_t m_capacity = 0;              // Vertices allocated in m_buffer
+    vector<Vertex> m_vertices;
+    size_t m_drawCount = 0;             // Grains in the last prepare()
+
+    size_t tail() const { return (m_head - m_count) & (DUST_CAPACITY - 1); }
+    float nextRandom();
+    void push(Vector2f position, Vector2f velocity, Color color, float birth);
+    void forSpans(const function<void(size_t first, size_t logical, int count)>& job, int grain);
+};
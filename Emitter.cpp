@@ -0,0 +1,46 @@
+#include "Emitter.h"
+#include <algorithm>
+
+Emitter::Emitter(Vector2i position, ParticleType type, float particlesPerSecond, float lifetime)
+{
+	m_position = position;
+	m_type = type;
+	m_rate = particlesPerSecond;
+	m_lifetime = lifetime;
+}
+
+void Emitter::addBurst(float time, int count)
+{
+	EmitterBurst burst = { time, count };
+	vector<EmitterBurst>::iterator position = upper_bound(m_bursts.begin() + m_nextBurst, m_bursts.end(), burst,
+		[](const EmitterBurst& a, const EmitterBurst& b) { return a.time < b.time; });
+	m_bursts.insert(position, burst);
+}
+
+// .:[Emitter Step]:.
+//          >> Steady emission carries its fractional remainder forward; bursts fire once their time is reached
+int Emitter::update(float dt)
+{
+	if (isExpired())
+	{
+		return 0;
+	}
+
+	float step = min(dt, MAX_EMIT_STEP);
+	if (m_lifetime >= 0)
+	{
+		step = min(step, m_lifetime - m_age);       // No emission past the end of life
+	}
+	m_age += dt;
+
+	m_accumulator += m_rate * step;
+	int count = (int)m_accumulator;
+	m_accumulator -= count;
+
+	while (m_nextBurst < m_bursts.size() && m_bursts[m_nextBurst].time <= m_age)
+	{
+		count += m_bursts[m_nextBurst].count;
+		++m_nextBurst;
+	}
+	return count;
+}
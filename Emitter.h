@@ -0,0 +1,51 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Particle.h"
+
+using namespace sf;
+using namespace std;
+
+const float MAX_EMIT_STEP = 0.1f;       // Longest step an emitter makes up for; a hitch can't turn into a flood
+
+// .:[Emitter Burst]:.
+struct EmitterBurst
+{
+    float time;                         // Seconds after the emitter was created
+    int count;
+};
+
+// .:[Emitter]:.
+//          >> Spawns particles of one type at a steady rate plus scheduled bursts. Emission is accumulated
+//          >> fractionally per simulation step, so the spawn rate is the same at 30 or 500 FPS.
+class Emitter
+{
+public:
+    ///lifetime < 0 keeps the emitter alive until removed
+    Emitter(Vector2i position, ParticleType type, float particlesPerSecond, float lifetime = -1.0f);
+
+    ///Bursts may be added in any order
+    void addBurst(float time, int count);
+
+    ///Advance by dt; returns how many particles to spawn this step
+    int update(float dt);
+
+    void setPosition(Vector2i position) { m_position = position; }
+    void setType(ParticleType type) { m_type = type; }
+    void setRate(float particlesPerSecond) { m_rate = particlesPerSecond; }
+
+    Vector2i getPosition() const { return m_position; }
+    ParticleType getType() const { return m_type; }
+    float getRate() const { return m_rate; }
+    bool isExpired() const { return m_lifetime >= 0 && m_age >= m_lifetime; }
+
+private:
+    Vector2i m_position;                // Pixel position, like a mouse click
+    ParticleType m_type;
+    float m_rate;
+    float m_lifetime;
+    float m_age = 0.0f;
+    float m_accumulator = 0.0f;         // Fraction of a particle carried into the next step
+    vector<EmitterBurst> m_bursts;      // Sorted by time
+    size_t m_nextBurst = 0;
+};
@@ -1,41 +1,314 @@
 #include "Engine.h"
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+
+// Left-click emission rates per particle ID; the old per-frame bursts of 5 and 2 at 60 FPS
+const ParticleType PARTICLE_TYPES[] = { NORMAL, CONSTANT, WAVE, GROW };
+const float MOUSE_EMIT_RATE[] = { 300.0f, 300.0f, 120.0f, 120.0f };
+const float DUST_BRUSH_RATE = 250000.0f;			// Dust grains per second while the D brush is held
+
+// HUD layout; the perf overlay refreshes a few times a second so its text, and the glyph cache, stay put in between
+const char* const PARTICLE_NAMES[] = { "Normal", "Constant", "Wave", "Grow" };
+const char* const QUALITY_NAMES[] = { "full", "reduced points", "throttled", "culling" };
+const float HUD_LEFT = 20.0f;
+const float HUD_TOP = 20.0f;
+const float HUD_LINE_HEIGHT = 50.0f;
+const float PERF_REFRESH = 0.25f;
+
+// Force field settings; accelerations in pixels per second squared
+const float MOUSE_FIELD_STRENGTH = 3000.0f;
+const float VORTEX_STRENGTH = 2000.0f;
+const float VORTEX_RADIUS = 400.0f;
+const float WIND_STRENGTH = 250.0f;
+const float TURBULENCE_STRENGTH = 400.0f;
+const float TURBULENCE_FREQUENCY = 0.01f;
+const float BREEZE_DRAG = 0.5f;
+
+// Metrics rates are averaged over this much wall time
+const float METRICS_RATE_WINDOW = 1.0f;
+static_assert(METRICS_TYPES == GROW + 1, "The metrics segment has one count per particle type");
+
+// B-key show: a ring of rockets, each firing staged bursts, then a finale once the sky has thinned out
+const int SHOW_ROCKETS = 12;
+const float SHOW_RADIUS = 250.0f;					// Pixels from the mouse to each rocket
+const float SHOW_STAGGER = 0.15f;					// Seconds between rocket launches
+const int ROCKET_BURSTS = 3;
+const int ROCKET_BURST_SIZE = 40;
+const int BURST_FRAMES = 8;							// Each burst is spread over this many steps
+const float ROCKET_GAP = 0.5f;
+const int FINALE_SIZE = 600;
+const int FINALE_FRAMES = 30;
+
+// F5 / F9 snapshot
+const char* const QUICK_SNAPSHOT = "snapshot.psnp";
+
+// Smoke grid size; its memory is allocated once at startup
+const int SMOKE_COLUMNS = 256;
+const int SMOKE_ROWS = 144;
 
 // .:[Constructor]:.
-Engine::Engine()
+Engine::Engine(bool headless)
+	: m_batch(m_threadPool), m_rasterizer(m_threadPool), m_smoke(m_threadPool, SMOKE_COLUMNS, SMOKE_ROWS), m_compact(m_threadPool), m_dust(m_threadPool), m_mouseEmitter(Vector2i(0, 0), NORMAL, MOUSE_EMIT_RATE[0])
 {
-	m_Window.create(VideoMode(1920, 1080), "Particles Project", Style::Default);			// Initializes RenderWindow
+	if (headless)
+	{
+		m_offscreen.create(1920, 1080);																// Initializes offscreen target in place of the window
+		m_target = &m_offscreen;
+	}
+	else
+	{
+		m_Window.create(VideoMode(1920, 1080), "Particles Project", Style::Default);			// Initializes RenderWindow
+		m_target = &m_Window;
+	}
 	particle_ID = 0; // >> Initializes the ID to 0
 	particle_Types = 3; // >> [[[IMPORTANT]]] INITIALIZE THIS VALUE WITH THE AMOUNT OF DIFFERENT PARTICLE TYPES MINUS ONE.
 
+	m_patterns.loadFromFile("patterns.txt");
+
+	// >> The collision scene is static, so its distance field is baked once here
+	vector<vector<Vector2f>> outlines;
+	m_patterns.getOutlines(m_target->getSize(), outlines);
+	m_collision.bake(outlines, m_target->getSize(), m_threadPool);
+
+	// >> Color-over-life ramps, baked here once; tints multiply each particle's own random colors
+	m_colorRamps[NORMAL] = ColorRamp({ { 0.0f, Color::White }, { 0.7f, Color::White }, { 1.0f, Color(255, 255, 255, 0) } });
+	m_colorRamps[CONSTANT] = ColorRamp({ { 0.0f, Color::White }, { 0.8f, Color::White }, { 1.0f, Color(255, 255, 255, 0) } });
+	m_colorRamps[WAVE] = ColorRamp({ { 0.0f, Color::White }, { 0.6f, Color(180, 200, 255) }, { 1.0f, Color(120, 140, 255, 0) } });
+	m_colorRamps[GROW] = ColorRamp({ { 0.0f, Color::White }, { 0.5f, Color(255, 200, 150) }, { 1.0f, Color(255, 80, 40, 0) } });
+
+	// >> Trail lengths in recorded steps; trails are only drawn while T has them on
+	m_particles.setTrailLength(NORMAL, 8);
+	m_particles.setTrailLength(CONSTANT, 6);
+	m_particles.setTrailLength(WAVE, 16);
+	m_particles.setTrailLength(GROW, 10);
+
+	// >> Gravity is the bottom field of the stack: full strength for normal particles, half for grow, none for constant and wave
+	ForceField gravity;
+	gravity.kind = FIELD_UNIFORM;
+	gravity.strength = G;
+	gravity.typeScale[CONSTANT] = 0.0f;
+	gravity.typeScale[WAVE] = 0.0f;
+	gravity.typeScale[GROW] = 0.5f;
+	m_fields.add(gravity);
+
 	if (!berlinSans.loadFromFile("BRLNSR.TTF"))
 	{
 		cout << "Error: Font cannot be loaded" << endl;
 	}
 
 	// Initialize text UI to indicate which particle is currently active
-	Text* line;
-	for (int i = 0; i < particle_Types + 1; i++)
+	m_hud.setFont(berlinSans, 20, true);
+	updateTypeListing();
+}
+
+// .:[Session Recording]:.
+//          >> Seeds rand() with a fresh seed and logs it so a replay draws the same random numbers; the options that
+//          >> change the simulation are logged with it, so call this once they are set
+bool Engine::startRecording(const string& path)
+{
+	uint32_t seed = (uint32_t)time(nullptr);
+	if (!m_recorder.open(path, seed, m_target->getSize(), getSessionOptions()))
+	{
+		return false;
+	}
+	srand(seed);
+	cout << "Recording session to " << path << " (seed " << seed << ")" << endl;
+	return true;
+}
+
+SessionOptions Engine::getSessionOptions() const
+{
+	SessionOptions options;
+	options.compactParticles = m_compactOn;
+	options.maxParticles = (uint32_t)m_quality.getMaxParticles();
+	return options;
+}
+
+// .:[Session Replay]:.
+//          >> Restores the recorded seed and options; run() then takes delta time and input from the log
+bool Engine::startReplay(const string& path)
+{
+	if (!m_player.open(path))
+	{
+		return false;
+	}
+	if (m_player.getWindowSize() != m_target->getSize())
+	{
+		cout << "Warning: Session was recorded at " << m_player.getWindowSize().x << "x" << m_player.getWindowSize().y
+			<< ", replay will not match exactly" << endl;
+	}
+	if (m_player.getVersion() >= SESSION_OPTIONS_VERSION)
+	{
+		const SessionOptions& options = m_player.getOptions();
+		if (options.compactParticles != m_compactOn || options.maxParticles != m_quality.getMaxParticles())
+		{
+			cout << "Replaying with " << (options.compactParticles ? "compact" : "heap") << " particles and a cap of "
+				<< options.maxParticles << " as recorded" << endl;
+		}
+		m_compactOn = options.compactParticles;
+		m_quality.setMaxParticles(options.maxParticles);
+	}
+	if (m_player.getVersion() < SESSION_EXACT_VERSION)
+	{
+		cout << "Warning: Session log version " << m_player.getVersion() << " predates version " << SESSION_EXACT_VERSION
+			<< ", replay will not match exactly" << endl;
+	}
+	srand(m_player.getSeed());
+	m_quality.setAdaptive(false);						// Stages depend on timing, which would break exact replay
+	cout << "Replaying session " << path << " (seed " << m_player.getSeed() << ")" << endl;
+	return true;
+}
+
+// .:[Video Wall]:.
+//          >> Blocks until the coordinator has a node for every tile. Quality adaptation stays on; each tile
+//          >> only has its own frame time to answer for
+bool Engine::joinWall(const string& host, unsigned short port)
+{
+	return m_wall.connect(host, port, m_target->getSize());
+}
+
+// .:[Snapshot Save]:.
+//          >> rand() has no readable state, so a fresh seed is drawn and applied here and stored with the snapshot;
+//          >> loading applies it again, which leaves both runs drawing the same numbers from this point on.
+//          >> F5 and F9 come through the input queue as SAVE and LOAD records, so a replay saves and loads at the same
+//          >> step the live run did; a save rewrites the file, so a later load in the replay reads what the live one read.
+//          >> Compact particles are decoded to full states after the heap ones, so a snapshot loads in either mode
+bool Engine::saveSnapshot(const string& path)
+{
+	vector<ParticleState> states(m_particles.size() + m_compact.size());
+	for (size_t i = 0; i < m_particles.size(); i++)
+	{
+		m_particles[i]->saveState(states[i]);
+	}
+	for (size_t i = 0; i < m_compact.size(); i++)
+	{
+		m_compact.saveState(i, states[m_particles.size() + i]);
+	}
+
+	SnapshotHeader header = {};
+	header.rngSeed = (uint32_t)rand();
+	header.particleID = particle_ID;
+	header.windowWidth = m_target->getSize().x;
+	header.windowHeight = m_target->getSize().y;
+	srand(header.rngSeed);
+
+	if (!SnapshotFile::write(path, header, states))
+	{
+		return false;
+	}
+	cout << "Saved " << states.size() << " particles to " << path << endl;
+	return true;
+}
+
+// .:[Snapshot Load]:.
+//          >> The file is mapped and checked in place, but the engine simulates Particles (or compact particles), not
+//          >> ParticleStates, so each state is rebuilt once into the store new particles go to and the mapping is then
+//          >> dropped. Positions are Cartesian around the window center, so a snapshot only loads at the window size
+//          >> it was saved at. Everything else in the scene is reset first, so a load always ends in the same state
+bool Engine::loadSnapshot(const string& path)
+{
+	SnapshotFile snapshot;
+	if (!snapshot.open(path))
+	{
+		return false;
+	}
+	const SnapshotHeader& header = snapshot.getHeader();
+	const ParticleState* states = snapshot.getParticles();
+	if (header.windowWidth != m_target->getSize().x || header.windowHeight != m_target->getSize().y)
+	{
+		cout << "Error: Snapshot " << path << " was saved at " << header.windowWidth << "x" << header.windowHeight
+			<< ", the window is " << m_target->getSize().x << "x" << m_target->getSize().y << endl;
+		return false;
+	}
+
+	resetScene();
+	if (!m_compactOn)
+	{
+		m_particles.reserve(header.particleCount);
+	}
+	uint64_t loaded = 0;
+	for (uint64_t i = 0; i < header.particleCount; i++)
+	{
+		const ParticleState& state = states[i];
+		if (!Particle::isValidState(state))
+		{
+			continue;
+		}
+		if (m_compactOn)
+		{
+			loaded += m_compact.add(state) ? 1 : 0;
+		}
+		else
+		{
+			m_particles.add(Particle::fromState(*m_target, state), m_simTime);
+			loaded++;
+		}
+	}
+
+	srand(header.rngSeed);
+	selectParticleType(header.particleID);
+	cout << "Loaded " << loaded << " of " << header.particleCount << " particles from " << path << endl;
+	return true;
+}
+
+// .:[Scene Reset]:.
+//          >> Back to the scene a fresh start has: no particles, dust, emitters, scripts or optional fields, and every
+//          >> toggle off. Gravity, the baked collision scene and the selected type stay
+void Engine::resetScene()
+{
+	m_particles.clear();
+	m_compact.clear();
+	m_dust.clear();
+	m_emitters.clear();
+	m_timeline.clear();
+	m_mouseHeld = false;
+	m_mouseFieldHeld = false;
+	int* fields[] = { &m_mouseField, &m_vortexField, &m_windField, &m_turbulenceField, &m_dragField };
+	for (int* field : fields)
+	{
+		if (*field != 0)
+		{
+			m_fields.remove(*field);
+			*field = 0;
+		}
+	}
+	m_collisionOn = false;
+	if (m_smokeOn)
+	{
+		toggleSmoke();
+	}
+	if (m_dustBrush)
 	{
-		line = new Text;
-		line->setFont(berlinSans);
-		line->setCharacterSize(20);
-		line->setFillColor(Color::White);
-		line->setStyle(Text::Bold);
-		line->setPosition(20, 20 + (50 * i));
-		particleUI.push_back(line);
+		toggleDust();
 	}
+}
 
-	particleUI.at(0)->setString("[1]    [Normal]");
-	particleUI.at(0)->setColor(Color::Yellow);
-	particleUI.at(1)->setString("[2]  [Constant] ");
-	particleUI.at(2)->setString("[3]  [Wave]");
-	particleUI.at(3)->setString("[4]  [Grow]");
+// .:[Scene Restart]:.
+//          >> A reset scene plus the clock, the mouse emitter, the selected type and the quality stage, so two runs
+//          >> from here with the same seed and input match exactly
+void Engine::restartScene()
+{
+	resetScene();
+	m_simTime = 0.0;
+	m_fields.resetTime();
+	m_mouseEmitter = Emitter(Vector2i(0, 0), NORMAL, MOUSE_EMIT_RATE[0]);
+	selectParticleType(0);
+	m_quality.setStage(QUALITY_FULL);
+	m_patterns.clearPrototypes();						// Rebuilt on the next J, so its rand() draws happen again
 }
 
 // .:[Engine Initialization]:.
+//          >> A live run steps on the simulation thread. Every frame polls input and presents; whenever the last
+//          >> step has finished, the frame first reads its results into the draw buffers and hands the thread
+//          >> the next step, covering all the wall time since. A frame that comes round while a step is still
+//          >> running presents the last buffers again, so a slow step lowers the step rate, not the frame rate.
+//          >> Replays and wall tiles step on this thread instead, once per frame, since every step has to line
+//          >> up with a logged or coordinated frame
 void Engine::run()
 {
 	Clock engineClock;			// Clock to keep track of delta time
+	Clock replayClock;			// Wall time spent replaying, reported when the log runs out
 
 	// Unit tests - Exact code, do not change!
 	cout << "Starting Particle unit tests..." << endl;
@@ -43,306 +316,1483 @@ void Engine::run()
 	p.unitTests();
 	cout << "Unit tests complete.  Starting engine..." << endl;
 
+	bool threaded = !m_player.isOpen() && !m_wall.isConnected();
+	if (threaded)
+	{
+		m_simulation.start([this](float dt) { step(dt); });
+	}
+	bool stepped = false;		// A step ran that hasn't been accounted for and drawn yet
+	float stepTime = 0.0f;		// How long that step took
+	float pendingTime = 0.0f;	// Wall time not yet handed to a step
+	float stepInterval = 0.0f;	// Wall time and frames since the last step was accounted for
+	int stepFrames = 0;
+	float renderTime = 0.0f;	// Preparing and presenting the last frame
+
 	// Endless repeating loop while window is open
 	while (m_Window.isOpen())
 	{
 		float delta = engineClock.restart().asSeconds();	// Register delta seconds, the time elapsed between frames
-		this->input();										// Check for user input
-		this->update(delta);								// Physics and logic updates; delta argument accounts for time elapsed
-		this->draw();										// Visual rendering
-	}
-}
 
-// .:[User Input Checks]:.
-void Engine::input()
-{
-	Event event;
-	while (m_Window.pollEvent(event))
-	{		
-		////////////////
-		// Window Closed
-		////////////////
-		if (event.type == Event::Closed)
+		// >> A replay substitutes the recorded delta so the simulation steps exactly as it did live
+		if (m_player.isOpen() && !m_player.nextFrame(delta))
 		{
-			// Quit the game when the window is closed
+			cout << "Replay finished: " << m_player.getFrame() << " frames in " << replayClock.getElapsedTime().asSeconds()
+				<< " s, " << countParticles() << " particles alive" << endl;
+			m_player.close();
 			m_Window.close();
+			break;
 		}
-		// Mouse Click Events
-		if (event.type == sf::Event::MouseButtonPressed)
+
+		// >> On a video wall the coordinator's frame replaces the measured delta and brings this tile's arrivals
+		if (m_wall.isConnected())
 		{
-			////////////////
-			// Right Click - Changes what particles left-click will generate
-			////////////////
-			if (event.mouseButton.button == sf::Mouse::Right)
+			if (m_wall.beginFrame(delta, m_arrivals))
 			{
-				// >> Turn formerly active color particle UI listing visually inactive
-				String fullString = particleUI.at(particle_ID)->getString();
-				String workingString = fullString.substring(0, fullString.find(" "));
-				workingString += "  ";
-				workingString += fullString.substring(fullString.find(' ') + 4);
-				particleUI.at(particle_ID)->setString(workingString);
-				particleUI.at(particle_ID)->setColor(Color::White);
-
-				// >> Increments the current particle ID by one.
-				++particle_ID;
-				// >> If it becomes more than the amount of particle types there are, it resets to 0.
-				if (particle_ID > particle_Types)
+				for (const ParticleState& state : m_arrivals)
 				{
-					particle_ID = 0;
+					if (Particle::isValidState(state))			// Another node's bytes; checked like a snapshot's
+					{
+						m_particles.add(Particle::fromState(*m_target, state), m_simTime);
+					}
 				}
-
-				// >> Format and color active particle UI listing
-				fullString = particleUI.at(particle_ID)->getString();
-				workingString = fullString.substring(0, fullString.find(" "));
-				workingString += "    ";
-				workingString += fullString.substring(fullString.find(' ') + 2);
-				particleUI.at(particle_ID)->setString(workingString);
-				particleUI.at(particle_ID)->setColor(Color::Yellow);
+			}
+			else
+			{
+				cout << "Lost the wall coordinator, continuing alone" << endl;
 			}
 		}
-	}
-	 
-	////////////////
-	// Left Click - Generates particles
-	//////////////// 
-	if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
-	{	
-		if (particle_ID == 0)
+
+		this->input();										// Check for user input
+		pendingTime += delta;
+		stepInterval += delta;
+		stepFrames++;
+		if (!threaded)
 		{
-			// Loop to create 5 particles
-			for (int i = 0; i < 5; i++)
+			Clock stepClock;
+			this->step(pendingTime);						// Physics and logic updates; delta argument accounts for time elapsed
+			if (m_wall.isConnected())
 			{
-				Particle* newParticle = new Particle(m_Window, (rand() % 26) + 25, Vector2i(Mouse::getPosition()));
-				m_particles.push_back(newParticle);
+				migrateParticles();							// Sent before drawing so the other tiles aren't kept waiting
 			}
+			stepTime = stepClock.getElapsedTime().asSeconds();
+			pendingTime = 0.0f;
+			stepped = true;
 		}
-		else if (particle_ID == 1)
+
+		// >> Nothing steps again until the next kick(), so from here to there the simulation can be read
+		Clock renderClock;
+		bool idle = false;
+		if (!threaded || m_simulation.isDone())
 		{
-			// Loop to create 5 particles
-			for (int i = 0; i < 5; i++)
+			if (stepped)
+			{
+				// >> Threaded, the step and the drawing overlap, so whichever is slower bounds the frame rate
+				if (threaded)
+				{
+					stepTime = m_simulation.getStepTime();
+				}
+				float work = threaded ? max(stepTime, renderTime) : stepTime + renderTime;
+				m_quality.endFrame(work);
+				QualityStage stage;
+				if (m_quality.takeStageRequest(stage) && !queueInput(SESSION_QUALITY, Vector2i(0, 0), (uint8_t)stage))
+				{
+					m_quality.cancelStageRequest();				// Queue full; asked for again next frame rather than waited on forever
+				}
+				updatePerfOverlay(stepInterval, stepFrames);
+				if (m_metrics.isOpen())
+				{
+					publishMetrics(stepInterval, work);
+				}
+				stepInterval = 0.0f;
+				stepFrames = 0;
+				stepped = false;
+			}
+			this->prepareDraw();
+			idle = isIdle();
+			if (threaded && !idle)
 			{
-				ConstantParticle* newParticle = new ConstantParticle(m_Window, (rand() % 26) + 25, Vector2i(Mouse::getPosition()), Color::Green);
-				m_particles.push_back(newParticle);
+				m_simulation.kick(pendingTime);
+				pendingTime = 0.0f;
+				stepped = true;
 			}
 		}
-		else if (particle_ID == 2)
+		this->draw();										// Visual rendering
+		renderTime = renderClock.getElapsedTime().asSeconds();
+
+		// >> Nothing on screen changes until input arrives, so block on it; replays and wall tiles aren't paced here
+		if (idle)
 		{
-			// Loop to create 2 particles
-			for (int i = 0; i < 2; i++)
+			Event event;
+			if (m_Window.waitEvent(event))
 			{
-				WaveParticle* newParticle = new WaveParticle(m_Window, (rand() % 26) + 25, Vector2i(Mouse::getPosition()));
-				m_particles.push_back(newParticle);
+				handleEvent(event);
 			}
+			engineClock.restart();
+			m_pacer.reset();
+			pendingTime = 0.0f;
 		}
-		else if (particle_ID == 3)
+		else if (!m_player.isOpen() && !m_wall.isConnected())
+		{
+			m_pacer.wait();
+		}
+	}
+	m_simulation.stop();
+	m_recorder.close();
+}
+
+// .:[Simulation Step]:.
+//          >> One frame of the session log and one update(); on the simulation thread during live runs
+void Engine::step(float dtAsSeconds)
+{
+	m_recorder.recordFrame(dtAsSeconds);
+	update(dtAsSeconds);
+}
+
+// .:[Idle Check]:.
+//          >> Nothing alive, scheduled, queued or held down: the next frame would look exactly like this one
+bool Engine::isIdle() const
+{
+	bool held = Mouse::isButtonPressed(Mouse::Left) || Mouse::isButtonPressed(Mouse::Middle) || Keyboard::isKeyPressed(Keyboard::J);
+	return m_inputQueue.empty() && countParticles() == 0 && m_dust.size() == 0 && m_emitters.empty() && m_timeline.getScriptCount() == 0 && !m_smokeOn && !held
+		&& !m_player.isOpen() && !m_wall.isConnected() && m_target == &m_Window;
+}
+
+// .:[Offline Rendering]:.
+//          >> Fixed timestep, no window. Frames are read back and queued to FrameWriter threads so the
+//          >> simulation only waits on disk or ffmpeg when the writer falls a whole queue behind
+bool Engine::renderOffline(const string& output, bool video, int frames, int fps)
+{
+	Vector2u size = m_target->getSize();
+	FrameWriter writer;
+	bool opened = video ? writer.openVideo(output, size, fps) : writer.openSequence(output, size);
+	if (!opened)
+	{
+		return false;
+	}
+
+	Clock renderClock;
+	float delta = 1.0f / fps;
+	m_quality.setAdaptive(false);						// Output must not depend on how fast this machine renders
+	for (int frame = 0; frame < frames && !writer.hasFailed(); frame++)
+	{
+		// >> A replayed session supplies one logged frame of input per output frame
+		if (m_player.isOpen())
 		{
-			// Loop to create 2 particles
-			for (int i = 0; i < 2; i++)
+			float loggedDelta;
+			if (m_player.nextFrame(loggedDelta))
 			{
-				GrowParticle* newParticle = new GrowParticle(m_Window, (rand() % 26) + 25, Vector2i(Mouse::getPosition()));
-				m_particles.push_back(newParticle);
+				replayInput();
+			}
+			else
+			{
+				m_player.close();
 			}
 		}
+		this->step(delta);
+		this->prepareDraw();
+		this->draw();
+
+		Image image = m_offscreen.getTexture().copyToImage();
+		vector<Uint8>* pixels = writer.acquire();
+		copy(image.getPixelsPtr(), image.getPixelsPtr() + pixels->size(), pixels->begin());
+		writer.submit(pixels);
 	}
-	// Keyboard Key events
+	bool written = writer.close();
+	cout << "Rendered " << writer.getFramesWritten() << " frames to " << output << " in "
+		<< renderClock.getElapsedTime().asSeconds() << " s" << endl;
+	return written;
+}
 
+// .:[Window Events]:.
+//          >> One event from pollEvent(), or from waitEvent() while the engine idles
+void Engine::handleEvent(const Event& event)
+{
 	////////////////
-	// Escape Key - Closes the program
+	// Window Closed
 	////////////////
-	if (Keyboard::isKeyPressed(Keyboard::Escape))
+	if (event.type == Event::Closed)
 	{
+		// Quit the game when the window is closed
 		m_Window.close();
 	}
-
-	bool jWasPressed = false;
-	
-	if (Keyboard::isKeyPressed(Keyboard::J)) {
-		if (!jWasPressed) {
-		
-			jWasPressed = true;
+	// Mouse Click Events - ignored during a replay, the log supplies them instead
+	if (event.type == sf::Event::MouseButtonPressed && !m_player.isOpen())
+	{
+		////////////////
+		// Right Click - Changes what particles left-click will generate
+		////////////////
+		if (event.mouseButton.button == sf::Mouse::Right)
+		{
+			queueInput(SESSION_RIGHT_CLICK);
 		}
 	}
-	else {
-		jWasPressed = false;
+	////////////////
+	// F3 - Shows or hides the perf overlay
+	////////////////
+	if (event.type == Event::KeyPressed && event.key.code == Keyboard::F3)
+	{
+		m_showPerf = !m_showPerf;
+		m_perfTimer = 0.0f;
+		m_perfFrames = 0;
+		m_perfSteps = 0;
+		m_hud.truncate(particle_Types + 2);
 	}
-
-	if (jWasPressed) {
-		Vector2u winSize = m_Window.getSize();									// window size
-		float circleRadius = 300.f;												// r
-		float circleYOffset = 150.f;
-
-		
-		Vector2f center(winSize.x / 2.f, winSize.y / 2.f - circleYOffset);		//artificial center (mapping purposes)
-
-		// circle
-		int numCircleParticles = 18;
-		for (int i = 0; i < numCircleParticles; ++i) {
-			float angle = i * (2 * M_PI / numCircleParticles);
-			float x = center.x + circleRadius * cos(angle);
-			float y = center.y + circleRadius * sin(angle);
-			m_particles.push_back(new WaveParticle(m_Window, 25, Vector2i((int)x, (int)y)));
-			m_particles.back()->setTTL(0.001f);
-		}
-
-		// horizontal line
-		int numParticlesX = 40;
-		float spacingX = winSize.x / (float)(numParticlesX + 1);
-		for (int i = 1; i <= numParticlesX; ++i) {
-			float x = i * spacingX;
-			float y = center.y;
-
-			float dx = x - center.x;
-			float dy = y - center.y;
-			float dist = sqrt(dx * dx + dy * dy);
-			if (dist >= circleRadius + 5) { // +5 buffer to leave gap
-				m_particles.push_back(new WaveParticle(m_Window, 30, Vector2i((int)x, (int)y)));
-				m_particles.back()->setTTL(0.001f);
-			}
+	////////////////
+	// T - Shows or hides particle trails
+	////////////////
+	if (event.type == Event::KeyPressed && event.key.code == Keyboard::T)
+	{
+		m_showTrails = !m_showTrails;
+	}
+	if (event.type == Event::KeyPressed && !m_player.isOpen())
+	{
+		////////////////
+		// F5 / F9 - Save / load a snapshot of the whole scene
+		////////////////
+		if (event.key.code == Keyboard::F5)
+		{
+			queueInput(SESSION_SAVE);
 		}
-
-		// vertical line
-		int numParticlesY = 30;
-		float spacingY = winSize.y / (float)(numParticlesY + 1);
-		for (int i = 1; i <= numParticlesY; ++i) {
-			float x = center.x;
-			float y = i * spacingY;
-
-			float dx = x - center.x;
-			float dy = y - center.y;
-			float dist = sqrt(dx * dx + dy * dy);
-			if (dist >= circleRadius + 5) {
-				m_particles.push_back(new WaveParticle(m_Window, 30, Vector2i((int)x, (int)y)));
-				m_particles.back()->setTTL(0.001f);
-			}
+		else if (event.key.code == Keyboard::F9)
+		{
+			queueInput(SESSION_LOAD);
 		}
-
-		// 5 petal rose curve
-		int numRoseParticles = 99;  // less is more
-		float roseRadius = 150.f;    // < circle radius
-		int k = 5;                   // 5 petals
-
-		for (int i = 0; i < numRoseParticles; ++i) {
-			float theta = i * (2 * M_PI / numRoseParticles); // angle step
-			float r = roseRadius * cos(k * theta);           // rose equation
-
-			float x = center.x + r * cos(theta);
-			float y = center.y + r * sin(theta);
-
-			m_particles.push_back(new WaveParticle(m_Window, 25, Vector2i((int)x, (int)y)));
-			m_particles.back()->setTTL(0.001f);
+		////////////////
+		// E - Drops an emitter of the current particle type at the mouse
+		////////////////
+		else if (event.key.code == Keyboard::E)
+		{
+			queueInput(SESSION_EMITTER, Vector2i(Mouse::getPosition()));
 		}
-
-		// rectangle shape thingy
-		float rectWidth = 80.f;
-		float rectHeight = 300.f;
-		float baseLegLength = 40.f;
-		float baseLegHeight = 20.f;
-
-		// center of 4th quadrant (bottom-right)
-		float rectX = winSize.x * 0.75f - rectWidth / 2.f;
-		float rectY = winSize.y * 0.75f - rectHeight / 2.f;
-
-		// center for 3rd quadrant
-		float dRectX = winSize.x * 0.25f - rectWidth / 2.f;  // X shifted to left quarter
-		float dRectY = winSize.y * 0.75f - rectHeight / 2.f; // Y stays in bottom half
-		Vector2f drectTopCenter(dRectX + rectWidth / 2.f, dRectY + 40.f);
-
-
-		// vahjra heart design
-		int heartPoints = 99;  // #
-		float scale = 123.0f;	// scale
-
-		for (int i = 0; i < heartPoints; ++i) {
-			float theta = i * (2 * M_PI / heartPoints);
-			// Polar heart equation
-			float r = scale * (1 - sin(theta));
-
-			float x = drectTopCenter.x + r * cos(theta);
-			float y = drectTopCenter.y + r * sin(theta);
-
-			m_particles.push_back(new ConstantParticle(m_Window, 20, Vector2i((int)x, (int)y)));
-			m_particles.back()->setTTL(0.001f);
+		////////////////
+		// V - Places a vortex at the mouse, or removes the one there is
+		////////////////
+		else if (event.key.code == Keyboard::V)
+		{
+			queueInput(SESSION_VORTEX, Vector2i(Mouse::getPosition()));
 		}
-
-		// rectangle border  //
-		int rectOutlinePoints = 25;
-		for (int i = 0; i < rectOutlinePoints; ++i) {
-			float t = i / (float)(rectOutlinePoints - 1);
-
-			// LHS
-			float xL = rectX;
-			float yL = rectY + t * rectHeight;
-			m_particles.push_back(new ConstantParticle(m_Window, 20, Vector2i((int)xL, (int)yL)));
-			m_particles.back()->setTTL(0.001f);
-
-			// RHS
-			float xR = rectX + rectWidth;
-			float yR = rectY + t * rectHeight;
-			m_particles.push_back(new ConstantParticle(m_Window, 20, Vector2i((int)xR, (int)yR)));
-			m_particles.back()->setTTL(0.001f);
+		////////////////
+		// W - Turns wind, turbulence and drag on or off
+		////////////////
+		else if (event.key.code == Keyboard::W)
+		{
+			queueInput(SESSION_BREEZE);
 		}
-
-		// Top and bottom lines of the rectangle
-		for (int i = 0; i < rectOutlinePoints; ++i) {
-			float t = i / (float)(rectOutlinePoints - 1);
-			float x = rectX + t * rectWidth;
-
-			// Top
-			m_particles.push_back(new ConstantParticle(m_Window, 20, Vector2i((int)x, (int)rectY)));
-			m_particles.back()->setTTL(0.001f);
-
-			// Bottom
-			m_particles.push_back(new ConstantParticle(m_Window, 20, Vector2i((int)x, (int)(rectY + rectHeight))));
-			m_particles.back()->setTTL(0.001f);
+		////////////////
+		// C - Makes particles bounce off the window borders and the J scene's outlines, or stops it
+		////////////////
+		else if (event.key.code == Keyboard::C)
+		{
+			queueInput(SESSION_COLLIDE);
 		}
-
-
-	}
-	}
-
-
-// .:[Engine Logic / Physics Updates]:.
-void Engine::update(float dtAsSeconds)
-{
-	// Create an iterator
-	for (vector<Particle*>::iterator it = m_particles.begin(); it != m_particles.end(); )
-	{
-		Particle* currentPointer = *it;
-		// Check TTL
-		if (currentPointer->getTTL() > 0.0f)
+		////////////////
+		// S - Turns the smoke field on or off
+		////////////////
+		else if (event.key.code == Keyboard::S)
 		{
-			// Call update
-			currentPointer->update(dtAsSeconds);
-
-			// Increment loop
-			++it;
+			queueInput(SESSION_SMOKE);
 		}
-		else
+		////////////////
+		// B - Starts a scripted show of staged bursts around the mouse
+		////////////////
+		else if (event.key.code == Keyboard::B)
 		{
-			// Remove particle if TTL expired
-			it = m_particles.erase(it);
+			queueInput(SESSION_SHOW, Vector2i(Mouse::getPosition()));
+		}
+		////////////////
+		// D - Switches left-click between the current particle type and spraying dust
+		////////////////
+		else if (event.key.code == Keyboard::D)
+		{
+			queueInput(SESSION_DUST);
 		}
 	}
 }
 
-// .:[Visual Rendering]:.
-void Engine::draw()
+// .:[User Input Checks]:.
+void Engine::input()
 {
-	m_Window.clear();
+	Event event;
+	while (m_Window.pollEvent(event))
+	{
+		handleEvent(event);
+	}
+
+	////////////////
+	// Escape Key - Closes the program
+	////////////////
+	if (Keyboard::isKeyPressed(Keyboard::Escape))
+	{
+		m_Window.close();
+	}
 
-	// Loop through all particles with an iterator and call their draw functions
-	for (vector<Particle*>::iterator it = m_particles.begin(); it != m_particles.end(); )
+	if (m_player.isOpen())
 	{
-		Particle* currentPointer = *it;
-		currentPointer->draw(m_Window, RenderStates::Default);
-		it++;
+		replayInput();
+		return;
+	}
+	 
+	////////////////
+	// Left Click - Generates particles
+	//////////////// 
+	if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
+	{	
+		queueInput(SESSION_LEFT_HOLD, Vector2i(Mouse::getPosition()));
 	}
 
-	for (Text* line : particleUI)
+	////////////////
+	// Middle Click - Attractor follows the mouse; hold shift to repel instead
+	////////////////
+	if (Mouse::isButtonPressed(Mouse::Middle))
 	{
-		m_Window.draw(*line);
+		bool repel = Keyboard::isKeyPressed(Keyboard::LShift) || Keyboard::isKeyPressed(Keyboard::RShift);
+		queueInput(repel ? SESSION_REPEL : SESSION_ATTRACT, Vector2i(Mouse::getPosition()));
 	}
+	// Keyboard Key events
 
-	// Display the window
-	m_Window.display();
-}
\ No newline at end of file
+	bool jWasPressed = false;
+	
+	if (Keyboard::isKeyPressed(Keyboard::J)) {
+		if (!jWasPressed) {
+		
+			jWasPressed = true;
+		}
+	}
+	else {
+		jWasPressed = false;
+	}
+
+	if (jWasPressed) {
+		queueInput(SESSION_PATTERN);
+	}
+}
+
+// .:[Replayed Input]:.
+//          >> Queues this frame's logged events exactly as live input would have
+void Engine::replayInput()
+{
+	SessionEvent event;
+	while (m_player.nextEvent(event))
+	{
+		m_inputQueue.push(event);
+	}
+}
+
+// .:[Input Queue]:.
+//          >> Input only captures events here; nothing is spawned or changed until the next step drains them.
+//          >> Returns false for an event the full queue dropped
+bool Engine::queueInput(SessionTag tag, Vector2i position, uint8_t value)
+{
+	SessionEvent event;
+	event.tag = tag;
+	event.position = position;
+	event.value = value;
+	if (!m_inputQueue.push(event))
+	{
+		m_droppedInputs++;								// Counted for the perf overlay; printing here would stall the frame
+		return false;
+	}
+	return true;
+}
+
+// .:[Input Drain]:.
+//          >> Runs at the start of every step. Discrete events apply in the order they arrived; repeated holds
+//          >> collapse to the latest position and apply after them. Events are logged as they are applied,
+//          >> so a replay queues exactly what this step saw and drains it the same way
+void Engine::drainInput()
+{
+	SessionEvent event;
+	SessionEvent emitterHold;
+	SessionEvent fieldHold;
+	bool emitterHeld = false;
+	bool fieldHeld = false;
+	while (m_inputQueue.pop(event))
+	{
+		if (event.tag == SESSION_LEFT_HOLD)
+		{
+			emitterHold = event;
+			emitterHeld = true;
+		}
+		else if (event.tag == SESSION_ATTRACT || event.tag == SESSION_REPEL)
+		{
+			fieldHold = event;
+			fieldHeld = true;
+		}
+		else
+		{
+			applyInput(event);
+		}
+	}
+	if (emitterHeld)
+	{
+		applyInput(emitterHold);
+	}
+	if (fieldHeld)
+	{
+		applyInput(fieldHold);
+	}
+}
+
+void Engine::applyInput(const SessionEvent& event)
+{
+	m_recorder.recordEvent(event);
+	switch (event.tag)
+	{
+	case SESSION_LEFT_HOLD:
+		holdMouseEmitter(event.position);
+		break;
+	case SESSION_EMITTER:
+		placeEmitter(event.position);
+		break;
+	case SESSION_RIGHT_CLICK:
+		switchParticleType();
+		break;
+	case SESSION_PATTERN:
+		if (runsScripts())
+		{
+			m_timeline.start(patternScript());
+		}
+		else
+		{
+			spawnPattern();
+		}
+		break;
+	case SESSION_ATTRACT:
+	case SESSION_REPEL:
+		holdMouseField(event.position, event.tag == SESSION_REPEL);
+		break;
+	case SESSION_VORTEX:
+		toggleVortex(event.position);
+		break;
+	case SESSION_BREEZE:
+		toggleBreeze();
+		break;
+	case SESSION_COLLIDE:
+		toggleCollision();
+		break;
+	case SESSION_SMOKE:
+		toggleSmoke();
+		break;
+	case SESSION_SHOW:
+		startShow(event.position);
+		break;
+	case SESSION_DUST:
+		toggleDust();
+		break;
+	case SESSION_SAVE:
+		saveSnapshot(QUICK_SNAPSHOT);
+		break;
+	case SESSION_LOAD:
+		loadSnapshot(QUICK_SNAPSHOT);
+		break;
+	case SESSION_QUALITY:
+		m_quality.setStage((QualityStage)min((int)event.value, (int)QUALITY_CULLING));
+		break;
+	default:
+		break;
+	}
+}
+
+// .:[Left Click Emission]:.
+//          >> Holding the button keeps the mouse emitter on for this frame; it spawns during update()
+void Engine::holdMouseEmitter(Vector2i mousePosition)
+{
+	m_mouseEmitter.setPosition(mousePosition);
+	m_mouseEmitter.setType(PARTICLE_TYPES[particle_ID]);
+	m_mouseEmitter.setRate(m_dustBrush ? DUST_BRUSH_RATE : MOUSE_EMIT_RATE[particle_ID]);
+	m_mouseHeld = true;
+}
+
+// .:[Mouse Field]:.
+//          >> Holding the middle button keeps the mouse attractor (or repeller) alive for this step
+void Engine::holdMouseField(Vector2i mousePosition, bool repel)
+{
+	m_mouseFieldPosition = mousePosition;
+	m_mouseFieldRepel = repel;
+	m_mouseFieldHeld = true;
+}
+
+// .:[Vortex Toggle]:.
+void Engine::toggleVortex(Vector2i mousePosition)
+{
+	if (m_vortexField != 0)
+	{
+		m_fields.remove(m_vortexField);
+		m_vortexField = 0;
+		return;
+	}
+	ForceField vortex;
+	vortex.kind = FIELD_VORTEX;
+	vortex.strength = VORTEX_STRENGTH;
+	vortex.position = toCartesian(mousePosition);
+	vortex.radius = VORTEX_RADIUS;
+	m_vortexField = m_fields.add(vortex);
+}
+
+// .:[Breeze Toggle]:.
+//          >> Wind blowing right, curling turbulence on top, and drag so speeds settle instead of growing
+void Engine::toggleBreeze()
+{
+	if (m_windField != 0)
+	{
+		m_fields.remove(m_windField);
+		m_fields.remove(m_turbulenceField);
+		m_fields.remove(m_dragField);
+		m_windField = m_turbulenceField = m_dragField = 0;
+		return;
+	}
+	ForceField wind;
+	wind.kind = FIELD_UNIFORM;
+	wind.direction = Vector2f(1.0f, 0.0f);
+	wind.strength = WIND_STRENGTH;
+	m_windField = m_fields.add(wind);
+
+	ForceField turbulence;
+	turbulence.kind = FIELD_TURBULENCE;
+	turbulence.strength = TURBULENCE_STRENGTH;
+	turbulence.frequency = TURBULENCE_FREQUENCY;
+	m_turbulenceField = m_fields.add(turbulence);
+
+	ForceField drag;
+	drag.kind = FIELD_DRAG;
+	drag.strength = BREEZE_DRAG;
+	m_dragField = m_fields.add(drag);
+}
+
+// .:[Pixel To Cartesian]:.
+//          >> Same mapping particles use for their centers: origin mid-window, y up
+Vector2f Engine::toCartesian(Vector2i pixel) const
+{
+	Vector2u size = m_target->getSize();
+	return Vector2f(pixel.x - size.x / 2.0f, size.y / 2.0f - pixel.y);
+}
+
+// .:[Emitter Placement]:.
+//          >> E key; leaves a short-lived emitter of the current type behind at the mouse. It runs as a script,
+//          >> except in replays of logs from before scripts, which spawned from m_emitters after the mouse emitter
+void Engine::placeEmitter(Vector2i mousePosition)
+{
+	Emitter emitter(mousePosition, PARTICLE_TYPES[particle_ID], 60.0f, 5.0f);
+	emitter.addBurst(0.0f, 20);
+	if (runsScripts())
+	{
+		m_timeline.start(emitterScript(emitter));
+	}
+	else
+	{
+		m_emitters.push_back(emitter);
+	}
+}
+
+// >> Sequences started from input are scripts unless a replayed log predates them
+bool Engine::runsScripts() const
+{
+	return !m_player.isOpen() || m_player.getVersion() >= SESSION_SCRIPT_VERSION;
+}
+
+// .:[Particle Spawning]:.
+//          >> Creates count particles of one type at a pixel position
+void Engine::spawnParticles(ParticleType type, Vector2i position, int count)
+{
+	count = m_quality.admit(count, countParticles());
+	if (!m_compactOn)
+	{
+		m_particles.reserve(m_particles.size() + count);
+	}
+	ParticleState state;
+	int spawned = 0;
+	for (int i = 0; i < count; i++)
+	{
+		// >> Compact particles go straight from the random numbers to a state, with no heap Particle in between;
+		//    the draws are the ones the constructors below make, so switching modes never shifts a replay
+		if (m_compactOn)
+		{
+			int numPoints = m_quality.pickPointCount();
+			Particle::randomState(type, *m_target, numPoints, position, (type == CONSTANT) ? Color::Green : Color::Black, state);
+			spawned += m_compact.add(state) ? 1 : 0;
+			continue;
+		}
+
+		Particle* newParticle;
+		if (type == CONSTANT)
+		{
+			newParticle = new ConstantParticle(*m_target, m_quality.pickPointCount(), position, Color::Green);
+		}
+		else if (type == WAVE)
+		{
+			newParticle = new WaveParticle(*m_target, m_quality.pickPointCount(), position);
+		}
+		else if (type == GROW)
+		{
+			newParticle = new GrowParticle(*m_target, m_quality.pickPointCount(), position);
+		}
+		else
+		{
+			newParticle = new Particle(*m_target, m_quality.pickPointCount(), position);
+		}
+		m_particles.add(newParticle, m_simTime);
+		spawned++;
+	}
+	m_spawnedTotal += spawned;
+}
+
+void Engine::toggleCollision()
+{
+	m_collisionOn = !m_collisionOn;
+}
+
+// .:[Smoke Toggle]:.
+//          >> Turning it off clears the grid, so it comes back clean
+void Engine::toggleSmoke()
+{
+	m_smokeOn = !m_smokeOn;
+	if (!m_smokeOn)
+	{
+		m_smoke.clear();
+	}
+}
+
+// .:[Dust Toggle]:.
+void Engine::toggleDust()
+{
+	m_dustBrush = !m_dustBrush;
+	m_typeListingDirty = true;
+}
+
+// .:[Particle Type Switching]:.
+//          >> Right click; changes what particles left-click will generate. With the dust brush on it only
+//          >> goes back to the type that was selected
+void Engine::switchParticleType()
+{
+	if (m_dustBrush)
+	{
+		toggleDust();
+		return;
+	}
+	// >> Increments the current particle ID by one.
+	++particle_ID;
+	// >> If it becomes more than the amount of particle types there are, it resets to 0.
+	if (particle_ID > particle_Types)
+	{
+		particle_ID = 0;
+	}
+	m_typeListingDirty = true;						// The HUD belongs to the main thread; prepareDraw() rebuilds it
+}
+
+// .:[Type Listing]:.
+//          >> The active type is indented further and yellow; only the lines that changed differ from what
+//          >> the HUD holds, so a switch rebuilds the glyph quads once. Dust is listed last, under its key
+void Engine::updateTypeListing()
+{
+	for (int i = 0; i <= particle_Types; i++)
+	{
+		bool active = (i == particle_ID && !m_dustBrush);
+		string text = "[" + to_string(i + 1) + "]" + (active ? "    [" : "  [") + PARTICLE_NAMES[i] + "]";
+		m_hud.setLine(i, text, active ? Color::Yellow : Color::White, Vector2f(HUD_LEFT, HUD_TOP + HUD_LINE_HEIGHT * i));
+	}
+	string text = string("[D]") + (m_dustBrush ? "    [" : "  [") + "Dust]";
+	m_hud.setLine(particle_Types + 1, text, m_dustBrush ? Color::Yellow : Color::White, Vector2f(HUD_LEFT, HUD_TOP + HUD_LINE_HEIGHT * (particle_Types + 1)));
+}
+
+// .:[Perf Overlay]:.
+//          >> Called once per finished step, with the wall time and presented frames since the last one.
+//          >> Averages over each refresh interval; the lines go under the type listing
+void Engine::updatePerfOverlay(float delta, int frames)
+{
+	if (!m_showPerf)
+	{
+		return;
+	}
+	m_perfTimer += delta;
+	m_perfFrames += frames;
+	m_perfSteps++;
+	if (m_perfTimer < PERF_REFRESH)
+	{
+		return;
+	}
+
+	char text[128];
+	size_t line = particle_Types + 2;
+	float top = HUD_TOP + HUD_LINE_HEIGHT * line;
+	snprintf(text, sizeof(text), "%.0f fps   %.0f steps/s   %.2f ms work", m_perfFrames / m_perfTimer, m_perfSteps / m_perfTimer,
+		m_quality.getAverageFrameTime() * 1000.0f);
+	m_hud.setLine(line, text, Color::Cyan, Vector2f(HUD_LEFT, top));
+	snprintf(text, sizeof(text), "%zu particles + %zu dust   %zu / %zu vertices uploaded", countParticles(), m_dust.size(),
+		m_batch.getUploadedVertices(), m_batch.getVertexCount());
+	m_hud.setLine(line + 1, text, Color::Cyan, Vector2f(HUD_LEFT, top + HUD_LINE_HEIGHT * 0.5f));
+	snprintf(text, sizeof(text), "quality: %s   %llu inputs dropped", QUALITY_NAMES[m_quality.getStage()],
+		(unsigned long long)m_droppedInputs);
+	m_hud.setLine(line + 2, text, Color::Cyan, Vector2f(HUD_LEFT, top + HUD_LINE_HEIGHT));
+	snprintf(text, sizeof(text), "paced to %.0f fps   jitter %.2f ms avg, %.2f max   %.0f%% asleep", m_pacer.getTargetFps(),
+		m_pacer.getJitter(), m_pacer.getMaxJitter(), m_pacer.getSleepShare() * 100.0f);
+	m_hud.setLine(line + 3, text, Color::Cyan, Vector2f(HUD_LEFT, top + HUD_LINE_HEIGHT * 1.5f));
+	m_perfTimer = 0.0f;
+	m_perfFrames = 0;
+	m_perfSteps = 0;
+}
+
+// .:[Metrics]:.
+//          >> Filled from counters the engine already keeps, so publishing is a copy into shared memory and
+//          >> never walks the particles
+void Engine::publishMetrics(float delta, float work)
+{
+	MetricsData& data = m_metricsData;
+	data.frame++;
+	data.simTime = m_simTime;
+	data.particles = (uint32_t)countParticles();
+	for (int type = 0; type < METRICS_TYPES; type++)
+	{
+		data.particlesByType[type] = (uint32_t)(m_particles.getTypeCount((ParticleType)type) + m_compact.getTypeCount((ParticleType)type));
+	}
+	data.spawnedTotal = m_spawnedTotal;
+	data.allocatedTotal = m_particles.getAddedTotal();
+	data.frameTime = delta * 1000.0f;
+	data.workTime = work * 1000.0f;
+	data.frameTimeHistogram[frameTimeBucket(data.frameTime)]++;
+	data.storeCapacity = (uint32_t)m_particles.getCapacity();
+	data.maxParticles = (uint32_t)m_quality.getMaxParticles();
+	data.qualityStage = (uint32_t)m_quality.getStage();
+
+	m_rateTimer += delta;
+	if (m_rateTimer >= METRICS_RATE_WINDOW)
+	{
+		data.spawnRate = (data.spawnedTotal - m_rateSpawned) / m_rateTimer;
+		data.allocationRate = (data.allocatedTotal - m_rateAdded) / m_rateTimer;
+		m_rateSpawned = data.spawnedTotal;
+		m_rateAdded = data.allocatedTotal;
+		m_rateTimer = 0.0f;
+	}
+	m_metrics.publish(data);
+}
+
+// .:[Particle Type Selection]:.
+//          >> Steps through the types so the UI listing gets formatted the same way right-clicking does
+void Engine::selectParticleType(int id)
+{
+	if (id < 0 || id > particle_Types)
+	{
+		return;
+	}
+	while (particle_ID != id)
+	{
+		switchParticleType();
+	}
+}
+
+// .:[Scripted Show]:.
+//          >> Every rocket is its own script, so a show is a dozen small timers rather than one long loop, and
+//          >> any number of shows can overlap
+void Engine::startShow(Vector2i mousePosition)
+{
+	m_timeline.start(showScript(mousePosition));
+}
+
+SceneScript Engine::showScript(Vector2i center)
+{
+	for (int i = 0; i < SHOW_ROCKETS; i++)
+	{
+		float angle = i * 2.0f * (float)M_PI / SHOW_ROCKETS;
+		Vector2i position = center + Vector2i((int)(SHOW_RADIUS * cosf(angle)), (int)(SHOW_RADIUS * sinf(angle)));
+		m_timeline.start(rocketScript(PARTICLE_TYPES[i % 4], position));
+		co_await m_timeline.delay(SHOW_STAGGER);
+	}
+
+	// >> The finale holds off until the rockets have mostly burned out, so it never lands on a full cap
+	co_await m_timeline.particlesBelow(m_quality.getMaxParticles() / 2);
+	for (int frame = 0; frame < FINALE_FRAMES; frame++)
+	{
+		spawnParticles(PARTICLE_TYPES[frame % 4], center, FINALE_SIZE / FINALE_FRAMES);
+		co_await m_timeline.nextFrame();
+	}
+}
+
+// >> A burst is spread over a few steps instead of landing in one
+SceneScript Engine::rocketScript(ParticleType type, Vector2i position)
+{
+	for (int burst = 0; burst < ROCKET_BURSTS; burst++)
+	{
+		for (int frame = 0; frame < BURST_FRAMES; frame++)
+		{
+			spawnParticles(type, position, ROCKET_BURST_SIZE / BURST_FRAMES);
+			co_await m_timeline.nextFrame();
+		}
+		co_await m_timeline.delay(ROCKET_GAP);
+	}
+}
+
+// .:[J Pattern]:.
+//          >> The scene spawns where scripts spawn, after the step's input and expiry, but always whole and in one
+//          >> step: its particles only live for PATTERN_TTL, so a scene split across steps would never show at once
+SceneScript Engine::patternScript()
+{
+	spawnPattern();
+	co_return;
+}
+
+// >> Stamps out the circle, axes, rose, heart and rectangle scene for one frame from the cached prototypes;
+//    the shapes themselves are defined in patterns.txt. Older logs call this straight from their PATTERN records
+void Engine::spawnPattern()
+{
+	const vector<Particle*>& prototypes = m_patterns.getPrototypes(*m_target);
+	if (countParticles() + prototypes.size() > m_quality.getMaxParticles())
+	{
+		return;
+	}
+	if (m_compactOn)
+	{
+		ParticleState state;
+		for (const Particle* prototype : prototypes)
+		{
+			prototype->saveState(state);
+			m_spawnedTotal += m_compact.add(state) ? 1 : 0;		// Points off the tiles are refused
+		}
+	}
+	else
+	{
+		m_particles.reserve(m_particles.size() + prototypes.size());
+		for (const Particle* prototype : prototypes)
+		{
+			m_particles.add(prototype->clone(), m_simTime);
+		}
+		m_spawnedTotal += prototypes.size();
+	}
+}
+
+// .:[Emitter Script]:.
+//          >> Spawns once per step for the simulated time since the last, until the emitter's lifetime runs out
+SceneScript Engine::emitterScript(Emitter emitter)
+{
+	double last = m_timeline.getTime();
+	while (!emitter.isExpired())
+	{
+		co_await m_timeline.nextFrame();
+		spawnParticles(emitter.getType(), emitter.getPosition(), emitter.update((float)(m_timeline.getTime() - last)));
+		last = m_timeline.getTime();
+	}
+}
+
+// .:[Engine Logic / Physics Updates]:.
+void Engine::update(float dtAsSeconds)
+{
+	drainInput();
+
+	// >> Expire everything whose TTL ran out before this step; only the wheel slots that are due get visited
+	m_particles.expire(m_simTime);
+	m_compact.expire();
+
+	// >> Scripts spawn through the same paths input does, after this step's input and before the emitters
+	m_timeline.advance(m_simTime, countParticles());
+
+	// >> Emitters spawn inside the simulation step, so emission follows simulated time rather than frame count
+	if (m_mouseHeld && m_dustBrush)
+	{
+		m_dust.spawn(toCartesian(m_mouseEmitter.getPosition()), m_mouseEmitter.update(dtAsSeconds), m_simTime);
+		m_mouseHeld = false;
+	}
+	else if (m_mouseHeld)
+	{
+		spawnParticles(m_mouseEmitter.getType(), m_mouseEmitter.getPosition(), m_mouseEmitter.update(dtAsSeconds));
+		m_mouseHeld = false;
+	}
+	if (m_dust.size() < m_dustFloor)
+	{
+		m_dust.scatter(Vector2f(m_target->getSize()), (int)(m_dustFloor - m_dust.size()), m_simTime);
+	}
+	for (vector<Emitter>::iterator it = m_emitters.begin(); it != m_emitters.end(); )
+	{
+		spawnParticles(it->getType(), it->getPosition(), it->update(dtAsSeconds));
+		if (it->isExpired())
+		{
+			it = m_emitters.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// >> Over budget: drop the particles closest to dying
+	size_t cullCount = m_quality.getCullCount(countParticles());
+	size_t compactCulled = min(cullCount, m_compact.size());
+	m_compact.cull(compactCulled);
+	m_particles.cullSoonest(cullCount - compactCulled);
+
+	// >> The mouse field is created on the first held step and removed on the first step without it
+	if (m_mouseFieldHeld)
+	{
+		ForceField* mouseField = m_fields.find(m_mouseField);
+		if (mouseField == nullptr)
+		{
+			ForceField field;
+			field.kind = FIELD_POINT;
+			m_mouseField = m_fields.add(field);
+			mouseField = m_fields.find(m_mouseField);
+		}
+		mouseField->position = toCartesian(m_mouseFieldPosition);
+		mouseField->strength = m_mouseFieldRepel ? -MOUSE_FIELD_STRENGTH : MOUSE_FIELD_STRENGTH;
+		m_mouseFieldHeld = false;
+	}
+	else if (m_mouseField != 0)
+	{
+		m_fields.remove(m_mouseField);
+		m_mouseField = 0;
+	}
+	m_fields.apply(m_particles.getParticles(), dtAsSeconds, &m_compact);
+
+	// >> Particles and air exchange momentum before the fluid steps, so this step's smoke follows this step's particles
+	if (m_smokeOn)
+	{
+		m_smoke.couple(m_particles.getParticles(), m_target->getSize(), dtAsSeconds);
+		m_smoke.step(dtAsSeconds);
+	}
+
+	// >> The tint follows the life reached at the start of the step, so a particle's first frame is never already faded
+	for (Particle* particle : m_particles)
+	{
+		particle->setTint(m_colorRamps[particle->getType()].sample(particle->getLife()));
+		Vector2f previousCenter = particle->getCenter();
+		particle->update(dtAsSeconds);
+		if (m_collisionOn)
+		{
+			m_collision.collide(*particle, previousCenter, dtAsSeconds);
+		}
+	}
+	m_particles.recordTrails();
+	m_particles.sortSpatial(m_threadPool);					// Keeps memory order close to screen order for the batch and the fields
+	m_compact.update(dtAsSeconds);
+	m_dust.update(dtAsSeconds, m_simTime);					// Expires the grains this step outlives, then moves the rest
+	m_simTime += dtAsSeconds;
+}
+
+// .:[Tile Migration]:.
+//          >> Particles whose center has moved over another tile leave this process as ParticleStates.
+//          >> Walking backwards keeps indices valid, since removal swaps the last particle into the hole
+void Engine::migrateParticles()
+{
+	ParticleState state;
+	for (size_t i = m_particles.size(); i-- > 0; )
+	{
+		int tile = m_wall.findTile(m_particles[i]->getCenter());
+		if (tile >= 0)
+		{
+			m_particles[i]->saveState(state);
+			if (m_wall.emigrate(tile, state))			// A full message leaves the rest for the next frame
+			{
+				m_particles.remove(i);
+			}
+		}
+	}
+	if (!m_wall.endFrame())
+	{
+		cout << "Lost the wall coordinator, continuing alone" << endl;
+	}
+}
+
+// .:[Draw Preparation]:.
+//          >> Reads the simulation into vertex buffers and textures, so draw() touches nothing a step writes.
+//          >> Only called while no step is running, which is also what keeps the thread pool to one user at a time
+void Engine::prepareDraw()
+{
+	if (m_typeListingDirty)
+	{
+		updateTypeListing();
+		m_typeListingDirty = false;
+	}
+
+	m_smokeShown = m_smokeOn;
+	if (m_smokeOn)
+	{
+		m_smoke.prepare();
+	}
+	if (m_softwareRendering)
+	{
+		prepareSoftware();
+	}
+	else
+	{
+		// Upload whatever changed since last frame
+		m_batch.update(m_particles.getParticles(), m_showTrails ? &m_particles.getTrails() : nullptr, *m_target);
+	}
+	m_dust.prepare(*m_target, m_simTime);
+	m_compact.prepare(*m_target, m_colorRamps);
+}
+
+// .:[Visual Rendering]:.
+//          >> Draws what the last prepareDraw() left, so it can run again while the next step is still going
+void Engine::draw()
+{
+	m_target->clear();
+
+	// Smoke goes down first so the fans draw over it
+	if (m_smokeShown)
+	{
+		m_smoke.draw(*m_target);
+	}
+
+	if (m_softwareRendering)
+	{
+		m_target->draw(Sprite(m_framebufferTexture));
+		m_dust.draw(*m_target);							// The rasterized frame is opaque, so dust goes on top
+	}
+	else
+	{
+		// Dust under the fans; a million single pixels would hide them otherwise
+		m_dust.draw(*m_target);
+
+		// All particles at once
+		m_batch.draw(*m_target);
+	}
+	m_compact.draw(*m_target);
+
+	// UI is left out of offline renders
+	if (m_target == &m_Window)
+	{
+		m_hud.draw(m_Window);
+	}
+
+	// Display the window, or finish the offscreen frame
+	if (m_target == &m_Window)
+	{
+		m_Window.display();
+	}
+	else
+	{
+		m_offscreen.display();
+	}
+}
+
+// .:[Software Rendering]:.
+//          >> Rasterizes every particle fan on the CPU into the framebuffer texture, which draw() blits in a single sprite
+void Engine::prepareSoftware()
+{
+	Vector2u size = m_target->getSize();
+	if (m_framebufferTexture.getSize() != size)
+	{
+		m_framebufferTexture.create(size.x, size.y);
+	}
+
+	m_rasterizer.begin(size);
+	for (Particle* particle : m_particles)
+	{
+		m_fanScratch.resize(particle->getNumPoints() + 1);
+		particle->mapFan(*m_target, m_fanScratch.data());
+		m_rasterizer.addFan(m_fanScratch.data(), particle->getNumPoints(), particle->getCenterColor(), particle->getOuterColor());
+	}
+	m_rasterizer.render();
+
+	m_framebufferTexture.update(m_rasterizer.getPixels());
+}
+
+// .:[Unit Tests]:.
+//          >> Engine-level checks for --unit-tests, reported the way Particle::unitTests() reports
+bool Engine::unitTests()
+{
+	int score = 0;
+	int total = 0;
+	auto report = [&](const char* name, bool (Engine::*test)())
+	{
+		cout << "Testing " << name << "...";
+		total++;
+		if ((this->*test)())
+		{
+			cout << "Passed.  +1" << endl;
+			score++;
+		}
+		else
+		{
+			cout << "Failed." << endl;
+		}
+	};
+
+	report("session record and replay", &Engine::testSessionReplay);
+	report("particle spawn states", &Engine::testSpawnStates);
+	report("snapshot save and load", &Engine::testSnapshotRoundTrip);
+	report("timing wheel expiry order", &Engine::testExpiryOrder);
+	report("radix sort stability", &Engine::testSortStability);
+	report("fast math error bounds", &Engine::testFastMath);
+	report("input queue wraparound", &Engine::testInputQueue);
+
+	cout << "Score: " << score << " / " << total << endl;
+	return score == total;
+}
+
+void Engine::captureParticles(vector<ParticleState>& states) const
+{
+	states.resize(m_particles.size());
+	for (size_t i = 0; i < m_particles.size(); i++)
+	{
+		memset(&states[i], 0, sizeof(ParticleState));			// Padding too, so states compare with memcmp
+		m_particles[i]->saveState(states[i]);
+	}
+}
+
+// .:[Spawn State Test]:.
+//          >> Compact mode spawns through Particle::randomState() instead of the constructors, so both must draw the
+//          >> same rand() numbers and land on the same state, or switching modes would shift every later spawn
+bool Engine::testSpawnStates()
+{
+	const int POINT_COUNTS[] = { 25, 50, MAX_POINTS + 6 };
+	bool matched = true;
+	for (int type = NORMAL; type <= GROW; type++)
+	{
+		for (int numPoints : POINT_COUNTS)
+		{
+			for (unsigned seed = 1; seed <= 8; seed++)
+			{
+				Vector2i position(100 * seed, 50 * seed);
+				srand(seed);
+				Particle* particle;
+				if (type == CONSTANT)
+				{
+					particle = new ConstantParticle(*m_target, numPoints, position, Color::Green);
+				}
+				else if (type == WAVE)
+				{
+					particle = new WaveParticle(*m_target, numPoints, position);
+				}
+				else if (type == GROW)
+				{
+					particle = new GrowParticle(*m_target, numPoints, position);
+				}
+				else
+				{
+					particle = new Particle(*m_target, numPoints, position);
+				}
+				ParticleState built, drawn;
+				memset(&built, 0, sizeof(ParticleState));
+				particle->saveState(built);
+				delete particle;
+				int builtNext = rand();
+
+				srand(seed);
+				memset(&drawn, 0, sizeof(ParticleState));
+				Particle::randomState((ParticleType)type, *m_target, numPoints, position, (type == CONSTANT) ? Color::Green : Color::Black, drawn);
+				matched = matched && memcmp(&built, &drawn, sizeof(ParticleState)) == 0 && rand() == builtNext;
+			}
+		}
+	}
+	return matched;
+}
+
+// .:[Snapshot Test]:.
+//          >> A saved scene loads back bit for bit, and rand() carries on from the same point after the load as after
+//          >> the save. Compact particles are lossy, so their round trip only has to keep what add() stores exactly
+bool Engine::testSnapshotRoundTrip()
+{
+	const string path = "unit-test.psnap";
+	const int FRAMES = 30;
+	bool compactOn = m_compactOn;
+	bool matched = true;
+	for (int compact = 0; compact < 2; compact++)
+	{
+		m_compactOn = (compact == 1);
+		restartScene();
+		srand(777);
+		for (int i = 0; i < 4; i++)
+		{
+			spawnParticles(PARTICLE_TYPES[i], Vector2i(400 + 300 * i, 500), 40);
+		}
+		for (int frame = 0; frame < FRAMES; frame++)
+		{
+			update(1.0f / 60.0f);
+		}
+
+		vector<ParticleState> saved, loaded;
+		captureCompact(saved);
+		captureParticles(loaded);
+		saved.insert(saved.end(), loaded.begin(), loaded.end());
+		matched = matched && !saved.empty() && saveSnapshot(path);
+		int afterSave = rand();
+
+		spawnParticles(NORMAL, Vector2i(960, 540), 50);
+		update(1.0f / 60.0f);
+		matched = matched && loadSnapshot(path);
+		int afterLoad = rand();
+		captureCompact(loaded);
+		vector<ParticleState> heap;
+		captureParticles(heap);
+		loaded.insert(loaded.end(), heap.begin(), heap.end());
+
+		matched = matched && afterSave == afterLoad && loaded.size() == saved.size();
+		for (size_t i = 0; matched && i < saved.size(); i++)
+		{
+			const ParticleState& a = saved[i];
+			const ParticleState& b = loaded[i];
+			if (!m_compactOn)
+			{
+				matched = memcmp(&a, &b, sizeof(ParticleState)) == 0;
+				continue;
+			}
+			matched = a.type == b.type && a.centerX == b.centerX && a.centerY == b.centerY && a.color1 == b.color1
+				&& a.color2 == b.color2 && a.vx == b.vx && a.vy == b.vy && a.lifetime == b.lifetime && fabsf(a.ttl - b.ttl) < 0.01f;
+		}
+		remove(path.c_str());
+	}
+	m_compactOn = compactOn;
+	restartScene();
+	return matched;
+}
+
+void Engine::captureCompact(vector<ParticleState>& states) const
+{
+	states.resize(m_compact.size());
+	for (size_t i = 0; i < m_compact.size(); i++)
+	{
+		memset(&states[i], 0, sizeof(ParticleState));
+		m_compact.saveState(i, states[i]);
+	}
+}
+
+// .:[Expiry Test]:.
+//          >> Lifetimes reach past level 1 into the overflow slot, and time moves in uneven steps across many
+//          >> cascades; after every expire() exactly the particles whose death time has passed are gone
+bool Engine::testExpiryOrder()
+{
+	const int COUNT = 2000;
+	ParticleStore store;
+	vector<double> deaths(COUNT);
+	srand(4321);
+	for (int i = 0; i < COUNT; i++)
+	{
+		Particle* particle = new Particle(*m_target, 25, Vector2i(960, 540));
+		float ttl = (i % 3 == 0) ? (float)(rand() % 400) : (rand() % 10000) * 0.001f;
+		particle->setTTL(ttl);
+		store.add(particle, 0.0);
+		deaths[i] = ttl;
+	}
+	sort(deaths.begin(), deaths.end());
+
+	bool ordered = true;
+	double now = 0.0;
+	while (ordered && !store.empty())
+	{
+		now += 0.004 + (rand() % 1000) * 0.0005;
+		store.expire(now);
+		size_t alive = deaths.end() - upper_bound(deaths.begin(), deaths.end(), now);
+		ordered = store.size() == alive;
+		for (size_t i = 0; ordered && i < store.size(); i++)
+		{
+			ordered = store[i]->getTTL() > now;
+		}
+	}
+	return ordered && now < 410.0;
+}
+
+// .:[Sort Stability Test]:.
+//          >> Particles share a handful of positions, so most keys repeat; sorted keys never descend, and equal
+//          >> keys keep the order they came in
+bool Engine::testSortStability()
+{
+	const int COUNT = 20000;
+	vector<Particle*> particles(COUNT);
+	vector<uint32_t> keys(COUNT);
+	srand(99);
+	for (int i = 0; i < COUNT; i++)
+	{
+		Vector2i position = (i % 4 == 0) ? Vector2i(rand() % 1920, rand() % 1080) : Vector2i(300 * (rand() % 4), 200 * (rand() % 4));
+		particles[i] = new Particle(*m_target, 25, position);
+		keys[i] = mortonCode(particles[i]->getCenter());
+	}
+
+	MortonSorter sorter;
+	const vector<uint32_t>& order = sorter.sort(m_threadPool, particles.data(), COUNT);
+	vector<bool> seen(COUNT, false);
+	bool stable = order.size() == (size_t)COUNT;
+	for (size_t j = 0; stable && j < order.size(); j++)
+	{
+		stable = order[j] < (uint32_t)COUNT && !seen[order[j]];
+		seen[order[j]] = true;
+		if (stable && j > 0)
+		{
+			uint32_t before = keys[order[j - 1]];
+			uint32_t after = keys[order[j]];
+			stable = before < after || (before == after && order[j - 1] < order[j]);
+		}
+	}
+	for (Particle* particle : particles)
+	{
+		delete particle;
+	}
+	return stable;
+}
+
+// .:[Fast Math Test]:.
+//          >> The bound FastMath.h promises, checked against double precision over the whole range it covers, and
+//          >> every finite half float surviving a round trip
+bool Engine::testFastMath()
+{
+	const int SAMPLES = 1 << 20;
+	double worst = 0.0;
+	for (int i = 0; i <= SAMPLES; i++)
+	{
+		float x = -8192.0f + 16384.0f * (float)i / SAMPLES;
+		float sine, cosine;
+		fastSinCos(x, sine, cosine);
+		worst = max(worst, max(fabs(sine - sin((double)x)), fabs(cosine - cos((double)x))));
+		worst = max(worst, max(fabs(fastSin(x) - sin((double)x)), fabs(fastCos(x) - cos((double)x))));
+	}
+
+	bool halves = floatToHalf(1.0e6f) == 0x7BFF && floatToHalf(-1.0e6f) == 0xFBFF;
+	for (uint32_t half = 0; half <= 0xFFFF; half++)
+	{
+		if (((half >> 10) & 0x1F) != 0x1F)
+		{
+			halves = halves && floatToHalf(halfToFloat((uint16_t)half)) == half;
+		}
+	}
+	return worst < 1.5e-7 && halves;
+}
+
+// .:[Input Queue Test]:.
+//          >> A small ring filled and drained unevenly wraps many times and must stay first in, first out, refusing
+//          >> a push only when full; then a producer thread streams through it while this thread reads in order
+bool Engine::testInputQueue()
+{
+	const size_t CAPACITY = 8;
+	SpscQueue<uint32_t, CAPACITY> small;
+	uint32_t pushed = 0;
+	uint32_t popped = 0;
+	bool inOrder = true;
+	srand(2024);
+	for (int round = 0; round < 2000 && inOrder; round++)
+	{
+		for (int i = rand() % 12; i > 0; i--)
+		{
+			if (!small.push(pushed))
+			{
+				inOrder = inOrder && pushed - popped == CAPACITY;
+				break;
+			}
+			pushed++;
+		}
+		for (int i = rand() % 12; i > 0; i--)
+		{
+			uint32_t item;
+			if (!small.pop(item))
+			{
+				inOrder = inOrder && pushed == popped && small.empty();
+				break;
+			}
+			inOrder = inOrder && item == popped++;
+		}
+	}
+
+	const uint32_t STREAM = 1 << 17;
+	SpscQueue<uint32_t, 64> queue;
+	thread producer([&queue, STREAM]
+	{
+		for (uint32_t i = 0; i < STREAM; i++)
+		{
+			while (!queue.push(i))
+			{
+				this_thread::yield();
+			}
+		}
+	});
+	uint32_t expected = 0;
+	while (expected < STREAM)
+	{
+		uint32_t item;
+		if (!queue.pop(item))
+		{
+			this_thread::yield();
+			continue;
+		}
+		inOrder = inOrder && item == expected;
+		expected++;
+	}
+	producer.join();
+	return inOrder && pushed > 10 * CAPACITY && queue.empty();
+}
+
+// .:[Session Replay Test]:.
+//          >> Records a few seconds of scripted input, with uneven frame times and quality stage changes mixed in,
+//          >> on the simulation thread as a live run would, then replays the log in lockstep from the same start
+//          >> and expects every particle to match bit for bit. Runs once with heap and once with compact particles,
+//          >> replaying each with the other mode set so the log's header has to restore it
+bool Engine::testSessionReplay()
+{
+	const string path = "unit-test.pses";
+	const int FRAMES = 240;
+	const uint32_t SEED = 12345;
+
+	bool compactOn = m_compactOn;
+	bool matched = false;
+	for (int compact = 0; compact < 2; compact++)
+	{
+		matched = false;
+		m_compactOn = (compact == 1);
+		restartScene();
+		if (!m_recorder.open(path, SEED, m_target->getSize(), getSessionOptions()))
+		{
+			break;
+		}
+		srand(SEED);
+		m_simulation.start([this](float dt) { step(dt); });
+		for (int frame = 0; frame < FRAMES; frame++)
+		{
+			if (frame < 60 || (frame >= 180 && frame < 200))
+			{
+				queueInput(SESSION_LEFT_HOLD, Vector2i(300 + 10 * (frame % 60), 400));
+			}
+			if (frame >= 80 && frame < 100)
+			{
+				queueInput(SESSION_ATTRACT, Vector2i(960, 540));
+			}
+			switch (frame)
+			{
+			case 15: case 30: case 180: queueInput(SESSION_RIGHT_CLICK); break;
+			case 45: queueInput(SESSION_QUALITY, Vector2i(0, 0), QUALITY_REDUCED_POINTS); break;
+			case 60: queueInput(SESSION_EMITTER, Vector2i(900, 300)); break;
+			case 70: queueInput(SESSION_PATTERN); break;
+			case 90: queueInput(SESSION_QUALITY, Vector2i(0, 0), QUALITY_THROTTLED); break;
+			case 100: queueInput(SESSION_VORTEX, Vector2i(800, 600)); break;
+			case 110: queueInput(SESSION_BREEZE); break;
+			case 120: queueInput(SESSION_QUALITY, Vector2i(0, 0), QUALITY_CULLING); break;
+			case 130: queueInput(SESSION_SHOW, Vector2i(1000, 500)); break;
+			case 140: queueInput(SESSION_SMOKE); break;
+			case 150: queueInput(SESSION_COLLIDE); break;
+			case 170: queueInput(SESSION_QUALITY, Vector2i(0, 0), QUALITY_FULL); break;
+			default: break;
+			}
+			float dt = 1.0f / 60.0f + 0.004f * (frame % 7) / 7.0f;
+			m_simulation.kick(dt);
+			m_simulation.wait();
+		}
+		m_simulation.stop();
+		m_recorder.close();
+		vector<ParticleState> recorded, compactRecorded;
+		captureParticles(recorded);
+		captureCompact(compactRecorded);
+		recorded.insert(recorded.end(), compactRecorded.begin(), compactRecorded.end());
+		double recordedTime = m_simTime;
+
+		restartScene();
+		m_compactOn = !m_compactOn;							// The log's header has to switch it back
+		bool replayed = startReplay(path);
+		float dt;
+		while (replayed && m_player.nextFrame(dt))
+		{
+			replayInput();
+			update(dt);
+		}
+		m_player.close();
+		m_quality.setAdaptive(true);
+		vector<ParticleState> replay, compactReplay;
+		captureParticles(replay);
+		captureCompact(compactReplay);
+		replay.insert(replay.end(), compactReplay.begin(), compactReplay.end());
+		matched = replayed && !recorded.empty() && replay.size() == recorded.size() && m_simTime == recordedTime
+			&& memcmp(replay.data(), recorded.data(), recorded.size() * sizeof(ParticleState)) == 0
+			&& m_compactOn == (compact == 1);
+		if (!matched)
+		{
+			break;
+		}
+	}
+
+	m_compactOn = compactOn;
+	restartScene();
+	remove(path.c_str());
+	return matched;
+}
@@ -8,6 +8,28 @@ Ivan Berniker
 #include <SFML/Graphics.hpp>
 #include <SFML/System/Clock.hpp>
 #include "Particle.h"
+#include "Session.h"
+#include "Snapshot.h"
+#include "FrameWriter.h"
+#include "SoftwareRasterizer.h"
+#include "ParticleBatch.h"
+#include "Pattern.h"
+#include "Emitter.h"
+#include "QualityController.h"
+#include "ParticleStore.h"
+#include "ColorRamp.h"
+#include "ForceField.h"
+#include "CollisionField.h"
+#include "SmokeField.h"
+#include "CompactParticle.h"
+#include "DustCloud.h"
+#include "SpscQueue.h"
+#include "HudText.h"
+#include "VideoWall.h"
+#include "Timeline.h"
+#include "FramePacer.h"
+#include "SimulationThread.h"
+#include "MetricsExport.h"
 using namespace sf;
 using namespace std;
 
@@ -17,30 +39,211 @@ private:
 	// A regular RenderWindow
 	RenderWindow m_Window;
 
-	//vector for Particles
-	vector<Particle*> m_particles;
+	// Offscreen target used instead of the window when rendering offline
+	RenderTexture m_offscreen;
+
+	// Where particles are spawned and drawn; points at m_Window or m_offscreen
+	RenderTarget* m_target;
+
+	// Worker threads shared by the CPU-heavy subsystems
+	ThreadPool m_threadPool;
+
+	// Persistent vertex buffer holding every particle fan, and trails while they are shown, drawn in one call
+	ParticleBatch m_batch;
+	bool m_showTrails = false;
+
+	// CPU draw backend; its framebuffer is uploaded to a texture and drawn as one sprite
+	bool m_softwareRendering = false;
+	SoftwareRasterizer m_rasterizer;
+	Texture m_framebufferTexture;
+	vector<Vector2f> m_fanScratch;
+
+	// Live particles, expired through a timing wheel keyed on simulated time
+	ParticleStore m_particles;
+	double m_simTime = 0.0;
+
+	// Color-over-life per particle type, indexed by ParticleType
+	ColorRamp m_colorRamps[GROW + 1];
+
+	// Gravity and every other force; the mouse field only exists on steps the middle button is held
+	ForceFieldStack m_fields;
+	int m_mouseField = 0;							// Field ids; 0 when the field is off
+	int m_vortexField = 0;
+	int m_windField = 0;
+	int m_turbulenceField = 0;
+	int m_dragField = 0;
+	bool m_mouseFieldHeld = false;
+	bool m_mouseFieldRepel = false;
+	Vector2i m_mouseFieldPosition;
+
+	// Distance field for the J scene's outlines and the window borders, baked at startup; C turns collision on
+	CollisionField m_collision;
+	bool m_collisionOn = false;
+
+	// Smoke grid the particles stir up, drawn under them; S turns it on
+	SmokeField m_smoke;
+	bool m_smokeOn = false;
+	bool m_smokeShown = false;						// m_smokeOn as of the last prepareDraw(), for draw()
+
+	// Packed store new particles are encoded into instead of m_particles while compact mode is on
+	CompactSwarm m_compact;
+	bool m_compactOn = false;
+	size_t countParticles() const { return m_particles.size() + m_compact.size(); }
+
+	// Shapeless point particles; D switches left-click to spraying them, and --dust keeps a cloud of them topped up
+	DustCloud m_dust;
+	bool m_dustBrush = false;
+	size_t m_dustFloor = 0;
 
 	// initalize ptr for controllabe particle
 	Particle* m_controllableParticle = nullptr;
 
 	// Private functions for internal use only
 	void input();
+	void handleEvent(const Event& event);
+	void step(float dtAsSeconds);
 	void update(float dtAsSeconds);
+	void prepareDraw();
+	void prepareSoftware();
 	void draw();
+
+	// Spawning and UI actions, shared by live input and session replay
+	void holdMouseEmitter(Vector2i mousePosition);
+	void placeEmitter(Vector2i mousePosition);
+	void spawnParticles(ParticleType type, Vector2i position, int count);
+	void holdMouseField(Vector2i mousePosition, bool repel);
+	void toggleVortex(Vector2i mousePosition);
+	void toggleBreeze();
+	void toggleCollision();
+	void toggleSmoke();
+	void toggleDust();
+	void resetScene();
+	void restartScene();
+	Vector2f toCartesian(Vector2i pixel) const;
+	void switchParticleType();
+	void spawnPattern();
+	void replayInput();
+	bool queueInput(SessionTag tag, Vector2i position = Vector2i(0, 0), uint8_t value = 0);
+	void drainInput();
+	void applyInput(const SessionEvent& event);
+	void selectParticleType(int id);
 	
 	// >> Values for particle switching
 	int particle_ID; // >>  Tracks the current particle to generate
 	int particle_Types; // >> How many different particle types there are,
 
+	// HUD: the particle type listing, plus the perf overlay while F3 has it on; one cached draw
 	Font berlinSans;
-	vector<Text*> particleUI;
-	Text testText;
+	HudText m_hud;
+	bool m_showPerf = false;
+	float m_perfTimer = 0.0f;						// Wall time, frames and steps since the overlay last refreshed
+	int m_perfFrames = 0;
+	int m_perfSteps = 0;
+	bool m_typeListingDirty = false;				// Set by steps, applied to the HUD by prepareDraw()
+	void updateTypeListing();
+	void updatePerfOverlay(float delta, int frames);
+
+	// Emitters; the mouse one only runs on frames the left button is held
+	Emitter m_mouseEmitter;
+	bool m_mouseHeld = false;
+	vector<Emitter> m_emitters;						// Placed emitters replayed from logs older than SESSION_SCRIPT_VERSION
+
+	// Particle cap and frame-time driven quality stages
+	QualityController m_quality;
+
+	// Frame rate cap for live runs; with nothing to animate the loop sleeps in waitEvent() instead
+	FramePacer m_pacer;
+	bool isIdle() const;
+
+	// Cached J-key scene
+	PatternLibrary m_patterns;
+
+	// Scene scripts, woken in simulated time; B starts a show at the mouse, J the pattern and E an emitter
+	Timeline m_timeline;
+	SceneScript showScript(Vector2i center);
+	SceneScript rocketScript(ParticleType type, Vector2i position);
+	SceneScript patternScript();
+	SceneScript emitterScript(Emitter emitter);
+	void startShow(Vector2i mousePosition);
+	bool runsScripts() const;
+
+	// Input captured by input() (or a replay) on the main thread, drained by update() at the start of each step
+	SpscQueue<SessionEvent, 1024> m_inputQueue;
+	uint64_t m_droppedInputs = 0;					// Events lost to a full queue, shown in the perf overlay
+
+	// Runs step() for live runs, so spawning and physics overlap the main thread's drawing
+	SimulationThread m_simulation;
+
+	// Session recording / deterministic replay
+	SessionRecorder m_recorder;
+	SessionPlayer m_player;
+
+	// Video wall tile; particles that cross into another tile are handed to the coordinator every step
+	WallNode m_wall;
+	vector<ParticleState> m_arrivals;
+	void migrateParticles();
+
+	// Live counters for external monitors, published to shared memory once per frame while --metrics is on
+	MetricsExport m_metrics;
+	MetricsData m_metricsData = {};
+	uint64_t m_spawnedTotal = 0;					// Particles created by emitters, clicks and the J scene
+	float m_rateTimer = 0.0f;						// Wall time since the rates last refreshed, and the totals then
+	uint64_t m_rateSpawned = 0;
+	uint64_t m_rateAdded = 0;
+	void publishMetrics(float delta, float work);
+
+	// Checks behind unitTests()
+	bool testSessionReplay();
+	bool testSpawnStates();
+	bool testSnapshotRoundTrip();
+	bool testExpiryOrder();
+	bool testSortStability();
+	bool testFastMath();
+	bool testInputQueue();
+	void captureParticles(vector<ParticleState>& states) const;
+	void captureCompact(vector<ParticleState>& states) const;
 
 public:
-	// The Engine constructor
-	Engine();
+	// The Engine constructor; a headless engine never opens a window and can only renderOffline()
+	Engine(bool headless = false);
 
 	// Run will call all the private functions
 	void run();
 
+	// Record input to a session log, or replay one instead of reading live input. Call before run()
+	bool startRecording(const string& path);
+	bool startReplay(const string& path);
+	SessionOptions getSessionOptions() const;
+
+	// Become one tile of a video wall; steps then come from the coordinator at its fixed rate. Call before run()
+	bool joinWall(const string& host, unsigned short port);
+
+	// Publish live counters to the named shared-memory object for tools/particle-metrics. Call before run()
+	bool openMetrics(const string& name) { return m_metrics.open(name); }
+
+	// Checkpoint the whole simulation to a snapshot file, or replace it with one
+	bool saveSnapshot(const string& path);
+	bool loadSnapshot(const string& path);
+
+	// Hard cap on live particles and the update + draw time quality is adapted to; live runs are also paced to targetFps
+	void setParticleBudget(size_t maxParticles, float targetFps) { m_quality.setMaxParticles(maxParticles); m_quality.setTargetFrameTime(1.0f / targetFps); m_pacer.setTargetFps(targetFps); }
+
+	// Draw particles with the CPU rasterizer instead of SFML. Pick this at startup, before run()
+	void setSoftwareRendering(bool enabled) { m_softwareRendering = enabled; }
+
+	// Spawn into the 28-byte compact representation instead of heap particles; trails, collision and smoke
+	// coupling only see heap particles. Pick this at startup, before run()
+	void setCompactParticles(bool enabled) { m_compactOn = enabled; }
+
+	// Keep at least count dust grains alive, scattered over the window, for benchmarking big clouds
+	void setDustFloor(size_t count) { m_dustFloor = min(count, (size_t)DUST_CAPACITY); }
+
+	// Headless checks of the engine and its modules, run by --unit-tests; true when every one passes
+	bool unitTests();
+
+	// Step the simulation at a fixed timestep and write every frame to a PNG sequence (prefix_00000.png, ...)
+	// or, when video is set, pipe it into ffmpeg. Input comes from a replayed session if one was started.
+	// Returns false if the output couldn't be opened or a frame couldn't be written
+	bool renderOffline(const string& output, bool video, int frames, int fps);
+
 };
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "FastMath.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const float FOUR_OVER_PI = 1.27323954473516f;
+const float PI_4_A = 0.78515625f;                  // pi/4 = A + B + C, A and B exact in few bits
+const float PI_4_B = 2.4187564849853515625e-4f;
+const float PI_4_C = 3.77489497744594108e-8f;
+
+// Minimax coefficients on [-pi/4, pi/4]
+const float SIN_1 = -1.6666654611e-1f;
+const float SIN_2 = 8.3321608736e-3f;
+const float SIN_3 = -1.9515295891e-4f;
+const float COS_1 = 4.166664568298827e-2f;
+const float COS_2 = -1.388731625493765e-3f;
+const float COS_3 = 2.443315711809948e-5f;
+
+// .:[Scalar Path]:.
+//          >> j is |x| / (pi/4) rounded up to an even number, so z = |x| - j * pi/4 lands in [-pi/4, pi/4].
+//          >> Bit 1 of j picks whether sin and cos swap polynomials, bit 2 flips sin, bit 2 of (j + 2) flips cos.
+void fastSinCos(float x, float& sine, float& cosine)
+{
+	float ax = fabsf(x);
+	int j = (int)(ax * FOUR_OVER_PI);
+	j = (j + 1) & ~1;
+	float y = (float)j;
+	float z = ((ax - y * PI_4_A) - y * PI_4_B) - y * PI_4_C;
+	float zz = z * z;
+
+	float s = z + z * zz * (SIN_1 + zz * (SIN_2 + zz * SIN_3));
+	float c = 1.0f - 0.5f * zz + zz * zz * (COS_1 + zz * (COS_2 + zz * COS_3));
+
+	if (j & 2)
+	{
+		float swap = s;
+		s = c;
+		c = swap;
+	}
+	if (j & 4)
+	{
+		s = -s;
+	}
+	if ((j + 2) & 4)
+	{
+		c = -c;
+	}
+	sine = (x < 0) ? -s : s;
+	cosine = c;
+}
+
+float fastSin(float x)
+{
+	float s, c;
+	fastSinCos(x, s, c);
+	return s;
+}
+
+float fastCos(float x)
+{
+	float s, c;
+	fastSinCos(x, s, c);
+	return c;
+}
+
+void sinCos(real x, real& sine, real& cosine)
+{
+#ifdef PARTICLE_MATH_DOUBLE
+	sine = sin(x);
+	cosine = cos(x);
+#else
+	fastSinCos(x, sine, cosine);
+#endif
+}
+
+// .:[Batch Path]:.
+//          >> Same steps as fastSinCos, four lanes at once; quadrant fixes are done with masks instead of branches
+void sinCosBatch(const real* angles, real* sines, real* cosines, int count)
+{
+	int i = 0;
+#if defined(__SSE2__) && !defined(PARTICLE_MATH_DOUBLE)
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i two = _mm_set1_epi32(2);
+	const __m128i four = _mm_set1_epi32(4);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(angles + i);
+		__m128 ax = _mm_andnot_ps(signMask, x);
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(FOUR_OVER_PI)));
+		j = _mm_andnot_si128(one, _mm_add_epi32(j, one));
+		__m128 y = _mm_cvtepi32_ps(j);
+		__m128 z = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(PI_4_A)));
+		z = _mm_sub_ps(z, _mm_mul_ps(y, _mm_set1_ps(PI_4_B)));
+		z = _mm_sub_ps(z, _mm_mul_ps(y, _mm_set1_ps(PI_4_C)));
+		__m128 zz = _mm_mul_ps(z, z);
+
+		__m128 s = _mm_add_ps(_mm_set1_ps(SIN_2), _mm_mul_ps(zz, _mm_set1_ps(SIN_3)));
+		s = _mm_add_ps(_mm_set1_ps(SIN_1), _mm_mul_ps(zz, s));
+		s = _mm_add_ps(z, _mm_mul_ps(_mm_mul_ps(z, zz), s));
+
+		__m128 c = _mm_add_ps(_mm_set1_ps(COS_2), _mm_mul_ps(zz, _mm_set1_ps(COS_3)));
+		c = _mm_add_ps(_mm_set1_ps(COS_1), _mm_mul_ps(zz, c));
+		c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), zz)), _mm_mul_ps(_mm_mul_ps(zz, zz), c));
+
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), two));
+		__m128 sine = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		__m128 cosine = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+		__m128 sineFlip = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29));
+		__m128 cosineFlip = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, two), four), 29));
+		sine = _mm_xor_ps(sine, _mm_xor_ps(sineFlip, _mm_and_ps(x, signMask)));
+		cosine = _mm_xor_ps(cosine, cosineFlip);
+
+		_mm_storeu_ps(sines + i, sine);
+		_mm_storeu_ps(cosines + i, cosine);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		sinCos(angles[i], sines[i], cosines[i]);
+	}
+}
+
+// .:[Half Float Packing]:.
+//          >> Bit manipulation only; the exponent is rebiased from 127 to 15 and the mantissa rounded from
+//          >> 23 bits to 10. A rounding carry that runs into the exponent is still the correctly rounded half
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF)
+	{
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	}
+	if (exponent >= 31)
+	{
+		return (uint16_t)(sign | 0x7BFF);
+	}
+	if (exponent <= 0)
+	{
+		// >> Subnormal half: the implicit bit becomes explicit and shifts down with the rest
+		if (exponent < -10)
+		{
+			return (uint16_t)sign;
+		}
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t middle = 1u << (shift - 1);
+		if (rest > middle || (rest == middle && (half & 1)))
+		{
+			half++;
+		}
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+	return (uint16_t)(sign | ((half >= 0x7C00) ? 0x7BFF : half));
+}
+
+float halfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		float magnitude = mantissa * 5.9604645e-8f;         // 2^-24, the smallest subnormal half
+		return sign ? -magnitude : magnitude;
+	}
+	else if (exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
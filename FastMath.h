@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+// .:[Simulation Precision]:.
+//          >> Particle geometry is stored and transformed in float32 by default, which is also what sf::Vertex
+//          >> ends up holding. Build with -DPARTICLE_MATH_DOUBLE to get the old all-double path back,
+//          >> with std::sin / std::cos in place of the approximations below.
+#ifdef PARTICLE_MATH_DOUBLE
+typedef double real;
+#else
+typedef float real;
+#endif
+
+// .:[Fast Sine / Cosine]:.
+//          >> Reduces x to [-pi/4, pi/4] around the nearest multiple of pi/4 (pi/4 split in three parts so the
+//          >> reduction stays exact), then evaluates degree 7 / degree 8 minimax polynomials.
+//          >> Absolute error is below 1.5e-7 for |x| <= 8192; beyond that the reduction itself loses precision.
+//          >> Every angle in the simulation is a few radians at most.
+void fastSinCos(float x, float& sine, float& cosine);
+float fastSin(float x);
+float fastCos(float x);
+
+///sin and cos at the configured precision
+void sinCos(real x, real& sine, real& cosine);
+
+///sin and cos of count angles; four at a time with SSE2 in the float build
+void sinCosBatch(const real* angles, real* sines, real* cosines, int count);
+
+// .:[Half Floats]:.
+//          >> IEEE binary16 packing for compact particle state. Rounds to nearest even; values past the largest
+//          >> half (65504) saturate instead of becoming infinite, and halves below 2^-24 flush to zero
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t half);
@@ -0,0 +1,178 @@
+#include "ForceField.h"
+#include <algorithm>
+#include <cmath>
+
+const float TURBULENCE_DRIFT_X = 0.7f;      // Radians per second the noise pattern slides along each axis
+const float TURBULENCE_DRIFT_Y = 1.1f;
+
+int ForceFieldStack::add(const ForceField& field)
+{
+	m_fields.push_back(field);
+	m_ids.push_back(++m_nextId);
+	return m_nextId;
+}
+
+void ForceFieldStack::remove(int id)
+{
+	for (size_t i = 0; i < m_ids.size(); i++)
+	{
+		if (m_ids[i] == id)
+		{
+			m_fields.erase(m_fields.begin() + i);
+			m_ids.erase(m_ids.begin() + i);
+			return;
+		}
+	}
+}
+
+ForceField* ForceFieldStack::find(int id)
+{
+	for (size_t i = 0; i < m_ids.size(); i++)
+	{
+		if (m_ids[i] == id)
+		{
+			return &m_fields[i];
+		}
+	}
+	return nullptr;
+}
+
+// .:[Apply Fields]:.
+//          >> Gather, one pass per field, scatter. Compact particles are gathered after the heap ones
+void ForceFieldStack::apply(const vector<Particle*>& particles, float dt, CompactSwarm* swarm)
+{
+	m_time += dt;
+	size_t heapCount = particles.size();
+	size_t count = heapCount + (swarm != nullptr ? swarm->size() : 0);
+	if (m_fields.empty() || count == 0)
+	{
+		return;
+	}
+
+	m_x.resize(count);
+	m_y.resize(count);
+	m_vx.resize(count);
+	m_vy.resize(count);
+	m_type.resize(count);
+	m_scale.resize(count);
+	m_ax.assign(count, 0.0f);
+	m_ay.assign(count, 0.0f);
+	for (size_t i = 0; i < heapCount; i++)
+	{
+		Vector2f center = particles[i]->getCenter();
+		Vector2f velocity = particles[i]->getVelocity();
+		m_x[i] = center.x;
+		m_y[i] = center.y;
+		m_vx[i] = velocity.x;
+		m_vy[i] = velocity.y;
+		m_type[i] = (uint8_t)particles[i]->getType();
+	}
+	for (size_t i = heapCount; i < count; i++)
+	{
+		Vector2f center = swarm->getCenter(i - heapCount);
+		Vector2f velocity = swarm->getVelocity(i - heapCount);
+		m_x[i] = center.x;
+		m_y[i] = center.y;
+		m_vx[i] = velocity.x;
+		m_vy[i] = velocity.y;
+		m_type[i] = (uint8_t)swarm->getType(i - heapCount);
+	}
+
+	for (const ForceField& field : m_fields)
+	{
+		applyField(field, count, dt);
+	}
+
+	for (size_t i = 0; i < heapCount; i++)
+	{
+		particles[i]->accelerate(m_ax[i], m_ay[i], dt);
+	}
+	for (size_t i = heapCount; i < count; i++)
+	{
+		swarm->accelerate(i - heapCount, m_ax[i], m_ay[i], dt);
+	}
+}
+
+// .:[Field Pass]:.
+//          >> m_scale carries type response times the bounds test, so every kind below is the same shape of loop
+void ForceFieldStack::applyField(const ForceField& field, size_t count, float dt)
+{
+	const float px = field.position.x;
+	const float py = field.position.y;
+	const float radiusSquared = (field.radius > 0.0f) ? field.radius * field.radius : INFINITY;
+	for (size_t i = 0; i < count; i++)
+	{
+		float dx = m_x[i] - px;
+		float dy = m_y[i] - py;
+		float inside = (dx * dx + dy * dy <= radiusSquared) ? 1.0f : 0.0f;
+		m_scale[i] = field.typeScale[m_type[i]] * inside;
+	}
+
+	const float strength = field.strength;
+	switch (field.kind)
+	{
+	case FIELD_UNIFORM:
+	{
+		const float ax = field.direction.x * strength;
+		const float ay = field.direction.y * strength;
+		for (size_t i = 0; i < count; i++)
+		{
+			m_ax[i] += ax * m_scale[i];
+			m_ay[i] += ay * m_scale[i];
+		}
+		break;
+	}
+	case FIELD_POINT:
+	case FIELD_VORTEX:
+	{
+		// >> Magnitude strength * s^2 / (d^2 + s^2): full strength near the center, inverse square far away.
+		//    A point field acts along (-dx, -dy), a vortex along the perpendicular (-dy, dx)
+		const float soft = FIELD_SOFTENING * FIELD_SOFTENING;
+		const bool vortex = (field.kind == FIELD_VORTEX);
+		for (size_t i = 0; i < count; i++)
+		{
+			float dx = m_x[i] - px;
+			float dy = m_y[i] - py;
+			float distanceSquared = dx * dx + dy * dy;
+			float k = m_scale[i] * strength * soft / ((distanceSquared + soft) * sqrtf(distanceSquared + 1.0f));
+			m_ax[i] += (vortex ? -dy : -dx) * k;
+			m_ay[i] += (vortex ? dx : -dy) * k;
+		}
+		break;
+	}
+	case FIELD_DRAG:
+	{
+		// >> Capped so a long step can stop a particle but never reverse it
+		const float drag = min(strength, 1.0f / dt);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_ax[i] -= m_vx[i] * drag * m_scale[i];
+			m_ay[i] -= m_vy[i] * drag * m_scale[i];
+		}
+		break;
+	}
+	case FIELD_TURBULENCE:
+	{
+		// >> x acceleration varies with y and y with x, so the flow curls instead of piling particles up
+		m_angles.resize(count);
+		m_sines.resize(count);
+		m_cosines.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_angles[i] = m_y[i] * field.frequency + m_time * TURBULENCE_DRIFT_X;
+		}
+		sinCosBatch(m_angles.data(), m_sines.data(), m_cosines.data(), (int)count);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_ax[i] += (float)m_sines[i] * strength * m_scale[i];
+			m_angles[i] = m_x[i] * field.frequency - m_time * TURBULENCE_DRIFT_Y;
+		}
+		sinCosBatch(m_angles.data(), m_sines.data(), m_cosines.data(), (int)count);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_ay[i] += (float)m_sines[i] * strength * m_scale[i];
+		}
+		break;
+	}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Particle.h"
+#include "CompactParticle.h"
+
+using namespace sf;
+using namespace std;
+
+const float FIELD_SOFTENING = 60.0f;    // Point and vortex fields reach full strength within this many pixels of their center
+
+// .:[Force Field Kinds]:.
+enum ForceFieldKind
+{
+    FIELD_UNIFORM,                      // Constant acceleration along direction; gravity and wind
+    FIELD_POINT,                        // Pulls toward position, pushes away with negative strength
+    FIELD_VORTEX,                       // Swirls around position, counter-clockwise with positive strength
+    FIELD_DRAG,                         // Slows particles down; strength is per second
+    FIELD_TURBULENCE                    // Smooth, slowly drifting noise; frequency sets the eddy size
+};
+
+// .:[Force Field]:.
+//          >> Positions are Cartesian like particle centers: origin mid-window, y up.
+//          >> Accelerations are in pixels per second squared.
+struct ForceField
+{
+    ForceFieldKind kind = FIELD_UNIFORM;
+    float strength = 0.0f;
+    Vector2f position;
+    Vector2f direction = Vector2f(0.0f, -1.0f);     // FIELD_UNIFORM only
+    float frequency = 0.01f;                        // FIELD_TURBULENCE only, in radians per pixel
+    float radius = 0.0f;                            // Particles farther than this from position are skipped; 0 covers everything
+    float typeScale[GROW + 1] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };      // Response of each ParticleType
+};
+
+// .:[Force Field Stack]:.
+//          >> Every step, particle positions and velocities are gathered into flat arrays, each field runs as
+//          >> its own straight-line pass adding into per-particle acceleration (bounds become a 0/1 factor,
+//          >> not a branch), and the summed accelerations are handed back through Particle::accelerate()
+class ForceFieldStack
+{
+public:
+    ///Returns an id for find() and remove(); ids are never reused
+    int add(const ForceField& field);
+    void remove(int id);
+    ForceField* find(int id);
+    void clear() { m_fields.clear(); m_ids.clear(); }
+
+    ///Restart turbulence drift from zero, as at startup
+    void resetTime() { m_time = 0.0f; }
+
+    ///Apply every field to every particle for a step of dt, the compact swarm's too when given
+    void apply(const vector<Particle*>& particles, float dt, CompactSwarm* swarm = nullptr);
+
+private:
+    vector<ForceField> m_fields;
+    vector<int> m_ids;                  // Parallel to m_fields
+    int m_nextId = 0;
+    float m_time = 0.0f;                // Drives turbulence drift
+
+    // Gathered particle data, reused between steps
+    vector<float> m_x, m_y, m_vx, m_vy, m_scale, m_ax, m_ay;
+    vector<uint8_t> m_type;
+    vector<real> m_angles, m_sines, m_cosines;
+
+    void applyField(const ForceField& field, size_t count, float dt);
+};
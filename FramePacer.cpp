@@ -0,0 +1,73 @@
+#include "FramePacer.h"
+#include <cmath>
+
+const Time SPIN_MARGIN = microseconds(1500);    // Longer than a scheduler tick on every desktop OS we run on
+const Time STATS_WINDOW = seconds(1.0f);
+
+void FramePacer::setTargetFps(float fps)
+{
+	m_period = (fps > 0.0f) ? microseconds((Int64)(1000000.0f / fps)) : Time::Zero;
+	reset();
+}
+
+void FramePacer::reset()
+{
+	m_deadline = m_clock.getElapsedTime();
+	m_counting = false;
+}
+
+// .:[Wait]:.
+void FramePacer::wait()
+{
+	if (m_period == Time::Zero)
+	{
+		return;
+	}
+
+	Time now = m_clock.getElapsedTime();
+	m_deadline += m_period;
+	if (now > m_deadline + m_period)
+	{
+		m_deadline = now;
+	}
+
+	Time sleepFor = m_deadline - now - SPIN_MARGIN;
+	if (sleepFor > Time::Zero)
+	{
+		sleep(sleepFor);
+		m_windowSleep += sleepFor;
+	}
+	Time wake = m_clock.getElapsedTime();
+	while (wake < m_deadline)
+	{
+		wake = m_clock.getElapsedTime();
+	}
+
+	// >> The first frame after a reset has no interval to measure
+	if (m_counting)
+	{
+		float jitter = fabsf((wake - m_lastWake - m_period).asMicroseconds() / 1000.0f);
+		m_jitterSum += jitter;
+		m_jitterPeak = (jitter > m_jitterPeak) ? jitter : m_jitterPeak;
+		m_jitterFrames++;
+	}
+	else
+	{
+		m_windowStart = wake;
+		m_windowSleep = Time::Zero;
+	}
+	m_counting = true;
+	m_lastWake = wake;
+
+	if (wake - m_windowStart >= STATS_WINDOW)
+	{
+		m_jitter = (m_jitterFrames > 0) ? m_jitterSum / m_jitterFrames : 0.0f;
+		m_maxJitter = m_jitterPeak;
+		m_sleepShare = m_windowSleep.asSeconds() / (wake - m_windowStart).asSeconds();
+		m_windowStart = wake;
+		m_windowSleep = Time::Zero;
+		m_jitterSum = 0.0f;
+		m_jitterPeak = 0.0f;
+		m_jitterFrames = 0;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <SFML/System.hpp>
+
+using namespace sf;
+
+// .:[Frame Pacer]:.
+//          >> Holds the main loop to a target frame rate without vsync. Each frame is due one period after the
+//          >> last one was, so timing errors don't accumulate; the wait sleeps until SPIN_MARGIN before the
+//          >> deadline and spins the rest, since a sleep can overshoot by a scheduler tick but a spin can't.
+//          >> A loop that falls more than a frame behind starts counting again from now instead of rushing
+//          >> frames out to catch up.
+//          >> Jitter is how far each frame's interval landed from the period, averaged and maxed over the
+//          >> last second.
+class FramePacer
+{
+public:
+    ///0 turns pacing off
+    void setTargetFps(float fps);
+    float getTargetFps() const { return m_period > Time::Zero ? 1.0f / m_period.asSeconds() : 0.0f; }
+
+    ///Sleep, then spin, until the next frame is due
+    void wait();
+
+    ///Start counting from now; call after the loop was blocked on something else, such as waitEvent()
+    void reset();
+
+    ///Milliseconds, over the last full second
+    float getJitter() const { return m_jitter; }
+    float getMaxJitter() const { return m_maxJitter; }
+
+    ///Share of the last full second spent asleep rather than spinning or working
+    float getSleepShare() const { return m_sleepShare; }
+
+private:
+    Clock m_clock;
+    Time m_period;
+    Time m_deadline;
+    Time m_lastWake;
+    bool m_counting = false;            // False until a frame has been paced since the last reset
+
+    // Current one-second window, and the figures from the last finished one
+    Time m_windowStart;
+    Time m_windowSleep;
+    float m_jitterSum = 0.0f;
+    float m_jitterPeak = 0.0f;
+    int m_jitterFrames = 0;
+    float m_jitter = 0.0f;
+    float m_maxJitter = 0.0f;
+    float m_sleepShare = 0.0f;
+};
@@ -0,0 +1,193 @@
+#include "FrameWriter.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <csignal>
+#include <sys/wait.h>
+#endif
+
+FrameWriter::~FrameWriter()
+{
+	close();
+}
+
+// .:[PNG Sequence Output]:.
+bool FrameWriter::openSequence(const string& prefix, Vector2u size, int threads, int queueSize)
+{
+	close();
+	if (prefix.empty())
+	{
+		cout << "Error: The PNG sequence needs a file name prefix" << endl;
+		return false;
+	}
+	m_framesWritten = 0;
+	m_failed = false;
+	m_prefix = prefix;
+	m_size = size;
+	allocateBuffers(queueSize);
+	for (int i = 0; i < threads; i++)
+	{
+		m_workers.emplace_back(&FrameWriter::workerLoop, this);
+	}
+	return true;
+}
+
+// .:[ffmpeg Pipe Output]:.
+//          >> popen() succeeds as long as the shell starts, so a missing or crashed ffmpeg only shows up as a failed
+//          >> write. SIGPIPE is ignored so that failure comes back from fwrite() instead of killing the process
+bool FrameWriter::openVideo(const string& path, Vector2u size, int fps, int queueSize)
+{
+	close();
+	if (path.empty())
+	{
+		cout << "Error: The video needs a file name" << endl;
+		return false;
+	}
+	m_framesWritten = 0;
+	m_failed = false;
+	m_size = size;
+#ifndef _WIN32
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	ostringstream command;
+	command << "ffmpeg -y -loglevel error -f rawvideo -pix_fmt rgba -s " << size.x << "x" << size.y
+		<< " -r " << fps << " -i - -pix_fmt yuv420p \"" << path << "\"";
+	m_pipe = popen(command.str().c_str(), "w");
+	if (m_pipe == nullptr)
+	{
+		cout << "Error: Could not start ffmpeg" << endl;
+		return false;
+	}
+
+	allocateBuffers(queueSize);
+	m_workers.emplace_back(&FrameWriter::workerLoop, this);
+	return true;
+}
+
+vector<Uint8>* FrameWriter::acquire()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_bufferFreed.wait(lock, [this] { return !m_freeBuffers.empty(); });
+	vector<Uint8>* buffer = m_freeBuffers.back();
+	m_freeBuffers.pop_back();
+	return buffer;
+}
+
+void FrameWriter::submit(vector<Uint8>* frame)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_queue.push_back({ m_nextIndex++, frame });
+	}
+	m_frameQueued.notify_one();
+}
+
+bool FrameWriter::close()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_closing = true;
+	}
+	m_frameQueued.notify_all();
+	for (thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	if (m_pipe != nullptr)
+	{
+		int status = pclose(m_pipe);
+		m_pipe = nullptr;
+#ifndef _WIN32
+		bool succeeded = (status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+#else
+		bool succeeded = (status == 0);
+#endif
+		if (!succeeded && !m_failed.exchange(true))
+		{
+			cout << "Error: ffmpeg failed (status " << status << "), the video is incomplete" << endl;
+		}
+	}
+	m_queue.clear();
+	m_freeBuffers.clear();
+	m_buffers.clear();
+	m_closing = false;
+	m_nextIndex = 0;
+	return !m_failed;
+}
+
+void FrameWriter::allocateBuffers(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		m_buffers.emplace_back(new vector<Uint8>(m_size.x * m_size.y * 4));
+		m_freeBuffers.push_back(m_buffers.back().get());
+	}
+}
+
+// .:[Writer Thread]:.
+//          >> Drains the queue until close() is called and nothing is left
+void FrameWriter::workerLoop()
+{
+	while (true)
+	{
+		QueuedFrame frame;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_frameQueued.wait(lock, [this] { return m_closing || !m_queue.empty(); });
+			if (m_queue.empty())
+			{
+				return;
+			}
+			frame = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		bool written = !m_failed && writeFrame(frame);
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_freeBuffers.push_back(frame.pixels);
+			m_framesWritten += written ? 1 : 0;
+		}
+		m_bufferFreed.notify_one();
+	}
+}
+
+// >> Only the first failure is reported; after it, frames are just handed back to the pool
+bool FrameWriter::writeFrame(const QueuedFrame& frame)
+{
+	if (m_pipe != nullptr)
+	{
+		if (fwrite(frame.pixels->data(), 1, frame.pixels->size(), m_pipe) != frame.pixels->size())
+		{
+			if (!m_failed.exchange(true))
+			{
+				cout << "Error: ffmpeg stopped taking frames at frame " << frame.index << "; is it installed?" << endl;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	Image image;
+	image.create(m_size.x, m_size.y, frame.pixels->data());
+	ostringstream fileName;
+	fileName << m_prefix << "_" << setw(5) << setfill('0') << frame.index << ".png";
+	if (!image.saveToFile(fileName.str()))
+	{
+		if (!m_failed.exchange(true))
+		{
+			cout << "Error: Could not write " << fileName.str() << endl;
+		}
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sf;
+using namespace std;
+
+// .:[Frame Writer]:.
+//          >> Hands rendered frames to background threads that write a PNG sequence or pipe raw RGBA into ffmpeg.
+//          >> Frames live in a fixed pool of buffers; acquire() only waits when every buffer is still queued,
+//          >> which bounds memory and lets rendering run ahead of the disk by the pool size.
+class FrameWriter
+{
+public:
+    ~FrameWriter();
+
+    ///Write prefix_00000.png, prefix_00001.png, ... using several encoder threads; the prefix can't be empty
+    bool openSequence(const string& prefix, Vector2u size, int threads = 4, int queueSize = 8);
+
+    ///Pipe frames to "ffmpeg ... -i - path"; frames must stay in order, so a single writer thread is used
+    bool openVideo(const string& path, Vector2u size, int fps, int queueSize = 8);
+
+    ///Get an empty w*h*4 buffer to render into
+    vector<Uint8>* acquire();
+
+    ///Queue a filled buffer for writing; it returns to the pool once written
+    void submit(vector<Uint8>* frame);
+
+    ///Wait for every queued frame to be written and stop the threads; false if any frame failed or ffmpeg did
+    bool close();
+
+    int getFramesWritten() const { return m_framesWritten; }
+
+    ///True once a frame could not be written; later frames are dropped, so callers should stop rendering
+    bool hasFailed() const { return m_failed; }
+
+private:
+    struct QueuedFrame
+    {
+        int index;
+        vector<Uint8>* pixels;
+    };
+
+    Vector2u m_size;
+    string m_prefix;
+    FILE* m_pipe = nullptr;
+
+    vector<unique_ptr<vector<Uint8>>> m_buffers;
+    vector<vector<Uint8>*> m_freeBuffers;
+    deque<QueuedFrame> m_queue;
+    mutex m_mutex;
+    condition_variable m_frameQueued;
+    condition_variable m_bufferFreed;
+    vector<thread> m_workers;
+    bool m_closing = false;
+    int m_nextIndex = 0;
+    int m_framesWritten = 0;
+    atomic<bool> m_failed{ false };
+
+    void allocateBuffers(int count);
+    void workerLoop();
+    bool writeFrame(const QueuedFrame& frame);
+};
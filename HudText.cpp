@@ -0,0 +1,120 @@
+#include "HudText.h"
+
+const float GLYPH_PADDING = 1.0f;       // Same margin sf::Text leaves so filtering doesn't clip glyph edges
+
+void HudText::setFont(const Font& font, unsigned int characterSize, bool bold)
+{
+	m_font = &font;
+	m_characterSize = characterSize;
+	m_bold = bold;
+	m_dirty = true;
+}
+
+void HudText::setLine(size_t index, const string& text, Color color, Vector2f position)
+{
+	if (index >= m_lines.size())
+	{
+		m_lines.resize(index + 1);
+		m_dirty = true;
+	}
+
+	Line& line = m_lines[index];
+	if (line.text != text || line.color != color || line.position != position)
+	{
+		line.text = text;
+		line.color = color;
+		line.position = position;
+		m_dirty = true;
+	}
+}
+
+void HudText::truncate(size_t count)
+{
+	if (count < m_lines.size())
+	{
+		m_lines.resize(count);
+		m_dirty = true;
+	}
+}
+
+// .:[Draw]:.
+//          >> The atlas texture is looked up after rebuild() since requesting a new glyph can grow the page
+void HudText::draw(RenderTarget& target)
+{
+	if (m_font == nullptr)
+	{
+		return;
+	}
+	if (m_dirty)
+	{
+		rebuild();
+	}
+	if (m_vertices.empty())
+	{
+		return;
+	}
+
+	RenderStates states;
+	states.texture = &m_font->getTexture(m_characterSize);
+	target.draw(m_vertices.data(), m_vertices.size(), Triangles, states);
+}
+
+// .:[Layout]:.
+//          >> The baseline sits one character size below the line's position, as with sf::Text
+void HudText::rebuild()
+{
+	m_vertices.clear();
+	float whitespace = m_font->getGlyph(L' ', m_characterSize, m_bold).advance;
+	float lineSpacing = m_font->getLineSpacing(m_characterSize);
+
+	for (const Line& line : m_lines)
+	{
+		float x = 0.0f;
+		float y = (float)m_characterSize;
+		Uint32 previous = 0;
+		for (unsigned char c : line.text)
+		{
+			Uint32 current = c;
+			x += m_font->getKerning(previous, current, m_characterSize);
+			previous = current;
+
+			if (current == ' ')
+			{
+				x += whitespace;
+				continue;
+			}
+			if (current == '\t')
+			{
+				x += whitespace * 4;
+				continue;
+			}
+			if (current == '\n')
+			{
+				x = 0.0f;
+				y += lineSpacing;
+				continue;
+			}
+
+			const Glyph& glyph = m_font->getGlyph(current, m_characterSize, m_bold);
+			float left = line.position.x + x + glyph.bounds.left - GLYPH_PADDING;
+			float top = line.position.y + y + glyph.bounds.top - GLYPH_PADDING;
+			float right = line.position.x + x + glyph.bounds.left + glyph.bounds.width + GLYPH_PADDING;
+			float bottom = line.position.y + y + glyph.bounds.top + glyph.bounds.height + GLYPH_PADDING;
+
+			float u1 = glyph.textureRect.left - GLYPH_PADDING;
+			float v1 = glyph.textureRect.top - GLYPH_PADDING;
+			float u2 = glyph.textureRect.left + glyph.textureRect.width + GLYPH_PADDING;
+			float v2 = glyph.textureRect.top + glyph.textureRect.height + GLYPH_PADDING;
+
+			m_vertices.push_back(Vertex(Vector2f(left, top), line.color, Vector2f(u1, v1)));
+			m_vertices.push_back(Vertex(Vector2f(right, top), line.color, Vector2f(u2, v1)));
+			m_vertices.push_back(Vertex(Vector2f(left, bottom), line.color, Vector2f(u1, v2)));
+			m_vertices.push_back(Vertex(Vector2f(left, bottom), line.color, Vector2f(u1, v2)));
+			m_vertices.push_back(Vertex(Vector2f(right, top), line.color, Vector2f(u2, v1)));
+			m_vertices.push_back(Vertex(Vector2f(right, bottom), line.color, Vector2f(u2, v2)));
+
+			x += glyph.advance;
+		}
+	}
+	m_dirty = false;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <vector>
+
+using namespace sf;
+using namespace std;
+
+// .:[HUD Text]:.
+//          >> Every HUD line is laid out into one vertex array of glyph quads cut from the font's atlas page,
+//          >> so the whole HUD is a single textured draw. Lines are compared on set; the quads are only
+//          >> rebuilt on the next draw after something actually changed, never per frame.
+//          >> Layout follows sf::Text: kerning, whitespace advance, one pixel of padding around each glyph.
+class HudText
+{
+public:
+    void setFont(const Font& font, unsigned int characterSize, bool bold);
+
+    ///Set or replace line index; position is the top-left corner in window pixels
+    void setLine(size_t index, const string& text, Color color, Vector2f position);
+
+    ///Drop every line from count on
+    void truncate(size_t count);
+
+    size_t getLineCount() const { return m_lines.size(); }
+
+    void draw(RenderTarget& target);
+
+private:
+    struct Line
+    {
+        string text;
+        Color color;
+        Vector2f position;
+    };
+
+    const Font* m_font = nullptr;
+    unsigned int m_characterSize = 20;
+    bool m_bold = false;
+    vector<Line> m_lines;
+    vector<Vertex> m_vertices;          // Two triangles per visible glyph
+    bool m_dirty = true;
+
+    void rebuild();
+};
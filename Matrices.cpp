@@ -7,15 +7,7 @@ namespace Matrices
     {
         rows = _rows;
         cols = _cols;
-        a.resize(rows);
-        for (int i = 0; i < rows; i++)
-        {
-            a.at(i).resize(cols);
-            for (int j = 0; j < cols; j++)
-            {
-                a.at(i).at(j) = 0;
-            }
-        }
+        a.assign(rows * cols, 0);
     }
 
 
@@ -70,7 +62,7 @@ namespace Matrices
             for (int i = 0; i < a.getRows(); i++)
             {
                 // Initialize running sum
-                double runningSum = 0.0;
+                real runningSum = 0;
                 // Column for a, row for b
                 for (int j = 0; j < a.getCols(); j++)
                 {
@@ -142,28 +134,28 @@ namespace Matrices
     }
 
     // .:[Rotation Matrix Constructor]:.
-    RotationMatrix::RotationMatrix(double theta) : Matrix(2, 2)
+    RotationMatrix::RotationMatrix(real theta) : Matrix(2, 2)
     {
-        a.at(0).at(0) = cos(theta);
-        a.at(0).at(1) = -sin(theta);
-        a.at(1).at(0) = sin(theta);
-        a.at(1).at(1) = cos(theta);
+        real sine, cosine;
+        sinCos(theta, sine, cosine);
+        (*this)(0, 0) = cosine;
+        (*this)(0, 1) = -sine;
+        (*this)(1, 0) = sine;
+        (*this)(1, 1) = cosine;
     }
 
     // .:[Scaling Matrix Constructor]:.
-    ScalingMatrix::ScalingMatrix(double scale) : Matrix(2, 2)
+    ScalingMatrix::ScalingMatrix(real scale) : Matrix(2, 2)
     {
-        a.at(0).at(0) = scale;
-        a.at(0).at(1) = 0;
-        a.at(1).at(0) = 0;
-        a.at(1).at(1) = scale;
+        (*this)(0, 0) = scale;
+        (*this)(1, 1) = scale;
     }
 
     // .:[Translation Matrix Constructor]:.
-    TranslationMatrix::TranslationMatrix(double xShift, double yShift, int nCols) : Matrix(2, nCols)
+    TranslationMatrix::TranslationMatrix(real xShift, real yShift, int nCols) : Matrix(2, nCols)
     {
-        for (int i = 0; i < nCols; i++) { a.at(0).at(i) = xShift; }     // Fills in first row
-        for (int i = 0; i < nCols; i++) { a.at(1).at(i) = yShift; }     // Fills in second row
+        for (int i = 0; i < nCols; i++) { (*this)(0, i) = xShift; }     // Fills in first row
+        for (int i = 0; i < nCols; i++) { (*this)(1, i) = yShift; }     // Fills in second row
     }
 
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <vector>
 #include <iomanip>
 #include <random>
+#include "FastMath.h"
 using namespace std;
 
 namespace Matrices
@@ -21,17 +22,17 @@ namespace Matrices
             ///inline accessors / mutators, these are done:
 
             ///Read element at row i, column j
-            ///usage:  double x = a(i,j);
-            const double& operator()(int i, int j) const
+            ///usage:  real x = a(i,j);
+            const real& operator()(int i, int j) const
             {
-                return a.at(i).at(j);
+                return a[i * cols + j];
             }
 
             ///Assign element at row i, column j
             ///usage:  a(i,j) = x;
-            double& operator()(int i, int j)
+            real& operator()(int i, int j)
             {
-                return a.at(i).at(j);
+                return a[i * cols + j];
             }
 
             int getRows() const{return rows;}
@@ -39,7 +40,8 @@ namespace Matrices
             ///************************************
         protected:
             ///changed to protected so sublasses can modify
-            vector<vector<double>> a;
+            ///one row-major block, a single allocation per matrix
+            vector<real> a;
         private:
             int rows;
             int cols;
@@ -79,7 +81,7 @@ namespace Matrices
             sin(theta)   cos(theta)
             */
             ///theta represents the angle of rotation in radians, counter-clockwise
-            RotationMatrix(double theta);
+            RotationMatrix(real theta);
     };
 
     ///2D scaling matrix
@@ -94,7 +96,7 @@ namespace Matrices
             0       scale
             */
             ///scale represents the size multiplier
-            ScalingMatrix(double scale);
+            ScalingMatrix(real scale);
     };
 
     ///2D Translation matrix
@@ -111,7 +113,7 @@ namespace Matrices
             ///paramaters are xShift, yShift, and nCols
             ///nCols represents the number of columns in the matrix
             ///where each column contains one (x,y) coordinate pair
-            TranslationMatrix(double xShift, double yShift, int nCols);
+            TranslationMatrix(real xShift, real yShift, int nCols);
     };
 }
 
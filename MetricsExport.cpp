@@ -0,0 +1,108 @@
+#include "MetricsExport.h"
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+int frameTimeBucket(float milliseconds)
+{
+	int bucket = 0;
+	while (bucket < FRAME_TIME_BUCKETS - 1 && milliseconds > FRAME_TIME_BOUNDS[bucket])
+	{
+		bucket++;
+	}
+	return bucket;
+}
+
+// .:[Seqlock Read]:.
+//          >> The acquire load pairs with the writer's final release store, and the acquire fence keeps the
+//          >> second sequence load from moving above the copy
+bool readMetrics(const MetricsSegment& segment, MetricsData& data, int tries)
+{
+	for (int i = 0; i < tries; i++)
+	{
+		uint32_t before = segment.sequence.load(memory_order_acquire);
+		if (before & 1)
+		{
+			continue;
+		}
+		memcpy(&data, (const void*)&segment.data, sizeof(MetricsData));
+		atomic_thread_fence(memory_order_acquire);
+		if (segment.sequence.load(memory_order_relaxed) == before)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MetricsExport::open(const string& name)
+{
+	close();
+#ifdef _WIN32
+	cout << "Error: Metrics export needs POSIX shared memory" << endl;
+	return false;
+#else
+	m_name = (name.empty() || name[0] != '/') ? "/" + name : name;
+	int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0 || ftruncate(fd, sizeof(MetricsSegment)) != 0)
+	{
+		cout << "Error: Cannot create shared memory " << m_name << endl;
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		return false;
+	}
+	void* mapping = mmap(nullptr, sizeof(MetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		cout << "Error: Cannot map shared memory " << m_name << endl;
+		shm_unlink(m_name.c_str());
+		return false;
+	}
+
+	// >> magic goes in last, so a reader that maps the object early never trusts a half-made header
+	m_segment = (MetricsSegment*)mapping;
+	m_segment->sequence.store(0, memory_order_relaxed);
+	memset(&m_segment->data, 0, sizeof(MetricsData));
+	m_segment->version = METRICS_VERSION;
+	m_segment->dataSize = sizeof(MetricsData);
+	atomic_thread_fence(memory_order_release);
+	m_segment->magic = METRICS_MAGIC;
+	cout << "Publishing metrics to shared memory " << m_name << endl;
+	return true;
+#endif
+}
+
+void MetricsExport::close()
+{
+#ifndef _WIN32
+	if (m_segment != nullptr)
+	{
+		munmap(m_segment, sizeof(MetricsSegment));
+		shm_unlink(m_name.c_str());
+		m_segment = nullptr;
+	}
+#endif
+}
+
+// .:[Seqlock Write]:.
+//          >> The release fence keeps the data stores below the odd sequence store; the final release store
+//          >> publishes them
+void MetricsExport::publish(const MetricsData& data)
+{
+	if (m_segment == nullptr)
+	{
+		return;
+	}
+	uint32_t sequence = m_segment->sequence.load(memory_order_relaxed);
+	m_segment->sequence.store(sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	memcpy((void*)&m_segment->data, &data, sizeof(MetricsData));
+	m_segment->sequence.store(sequence + 2, memory_order_release);
+}
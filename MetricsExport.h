@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// .:[Metrics Segment Layout]:.
+//          >> One POSIX shared-memory object per display, written by the engine once per frame and read by
+//          >> tools/particle-metrics (or anything else that maps it). Publishing is a seqlock: the writer makes
+//          >> sequence odd, copies the data in, and makes it even again; a reader copies the data out and
+//          >> retries if sequence was odd or moved meanwhile. The engine never waits on a reader, takes no
+//          >> lock and does no I/O; a slow reader only costs itself retries.
+//          >> Totals only ever grow, so a scraper can take rates over whatever interval it likes; the rates
+//          >> below are the engine's own, over the last second.
+const uint32_t METRICS_MAGIC = 0x54454D50;     // "PMET"
+const uint32_t METRICS_VERSION = 1;
+const int METRICS_TYPES = 5;                    // ParticleType values, RANDOM through GROW
+const int FRAME_TIME_BUCKETS = 12;
+
+///Upper bound of each frame time bucket in milliseconds; the last bucket takes everything slower
+const float FRAME_TIME_BOUNDS[FRAME_TIME_BUCKETS] = { 1.0f, 2.0f, 4.0f, 8.0f, 12.0f, 16.7f, 20.0f, 25.0f, 33.3f, 50.0f, 100.0f, 1e30f };
+
+struct MetricsData
+{
+    uint64_t frame;                                 // Simulation steps published; a live run can present more frames than it steps
+    double simTime;                                 // Seconds simulated
+    uint32_t particles;
+    uint32_t particlesByType[METRICS_TYPES];        // Indexed by ParticleType
+    uint64_t spawnedTotal;                          // Particles created by emitters, clicks and patterns
+    uint64_t allocatedTotal;                        // Every particle the store took on, including loads and migrations
+    float spawnRate;                                // Per second, over the last second
+    float allocationRate;
+    float frameTime;                                // Wall time the last step covered, milliseconds
+    float workTime;                                 // Last step's update + draw, or the slower of the two when they overlap, milliseconds
+    uint64_t frameTimeHistogram[FRAME_TIME_BUCKETS];    // Steps per bucket since start
+    uint32_t storeCapacity;                         // Particle slots allocated in the store
+    uint32_t maxParticles;                          // Hard cap
+    uint32_t qualityStage;                          // QualityStage
+    uint32_t padding;
+};
+
+struct MetricsSegment
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dataSize;                  // sizeof(MetricsData) when written
+    atomic<uint32_t> sequence;          // Odd while a write is in progress
+    MetricsData data;
+};
+
+static_assert(atomic<uint32_t>::is_always_lock_free, "The seqlock counter must be lock-free to live in shared memory");
+
+///Bucket a frame time in milliseconds falls in
+int frameTimeBucket(float milliseconds);
+
+///Copy a consistent snapshot of the data out of a mapped segment; gives up and returns false after tries torn reads
+bool readMetrics(const MetricsSegment& segment, MetricsData& data, int tries = 1000);
+
+// .:[Metrics Export]:.
+//          >> Owns the shared-memory object: creates it, maps it and unlinks it again on close
+class MetricsExport
+{
+public:
+    MetricsExport() {}
+    ~MetricsExport() { close(); }
+    MetricsExport(const MetricsExport&) = delete;
+    MetricsExport& operator=(const MetricsExport&) = delete;
+
+    ///name is a POSIX shared-memory name like /particles-metrics; the slash is added if missing
+    bool open(const string& name);
+    void close();
+    bool isOpen() const { return m_segment != nullptr; }
+
+    void publish(const MetricsData& data);
+
+private:
+    MetricsSegment* m_segment = nullptr;
+    string m_name;
+};
@@ -1,5 +1,7 @@
 #include "Particle.h"
 
+uint64_t Particle::s_nextVersion = 0;
+
 ///////////////////////////////////////////////
 // Normal Particle
 //          -Falls with gravity and shrinks
@@ -10,6 +12,8 @@ Particle::Particle(RenderTarget& target, int numPoints, Vector2i mouseClickPosit
     :m_A(2, numPoints) // Constructs a Matrix of 2 rows and numPoints columns to store a set of coordinates in
 {
     m_ttl = TTL;                                                                            // Particle life duration, retrieves via a constant
+    m_lifetime = TTL;
+    m_version = ++s_nextVersion;                                                            // Fresh version so draw caches never mistake this for an older particle
     m_numPoints = numPoints;                                                                // Number of points, passed in from initialization
     m_radiansPerSec = ((float)rand() / (RAND_MAX)) * M_PI;                                  // Radians Per Second
     m_cartesianPlane.setCenter(0, 0);                                                       // Sets Cartesian Plane center to 0, 0
@@ -48,6 +52,8 @@ Particle::Particle(RenderTarget& target, int numPoints, Vector2i mouseClickPosit
     {
         m_color2 = particleColor;
     }
+    m_tintedColor1 = m_color1;
+    m_tintedColor2 = m_color2;
 
     ////////////////
     // Algorithm
@@ -58,32 +64,226 @@ Particle::Particle(RenderTarget& target, int numPoints, Vector2i mouseClickPosit
     double upperBound = M_PI / 2;
     std::uniform_real_distribution<double> unif(lowerBound, upperBound);
     std::default_random_engine re;
-    double theta = unif(re);
+    real theta = unif(re);
 
     // NOTE: Theta always initializes to 0.212807 without variation? Not sure if this is a real issue, but good to look into eventually.
     // Possibly due to needing to include some library functions somewhere? Uncomment the following cout line to test.
     //cout << "Theta: " << theta << endl;
 
     // Initializes dTheta
-    double dTheta = 2 * M_PI / (numPoints - 1);
+    real dTheta = 2 * M_PI / (numPoints - 1);
 
     // Loops j to numPoints to store each point location to the Matrix of coordinates
-    for (int j = 0; j < numPoints; ++j)
+    // >> Angles are evaluated a block at a time so the trig runs through sinCosBatch
+    const int TRIG_BLOCK = 64;
+    real angles[TRIG_BLOCK], sines[TRIG_BLOCK], cosines[TRIG_BLOCK];
+    for (int first = 0; first < numPoints; first += TRIG_BLOCK)
     {
-        double r, dx, dy;
-        r = rand() % int(61 * particleSize) + (20 * particleSize);
-
-        dx = r * cos(theta);
-        dy = r * sin(theta);
+        int count = min(TRIG_BLOCK, numPoints - first);
+        for (int k = 0; k < count; ++k)
+        {
+            angles[k] = theta + (first + k) * dTheta;
+        }
+        sinCosBatch(angles, sines, cosines, count);
 
-        m_A(0, j) = m_centerCoordinate.x + dx;
-        m_A(1, j) = m_centerCoordinate.y + dy;
-        theta += dTheta;
+        for (int k = 0; k < count; ++k)
+        {
+            real r = rand() % int(61 * particleSize) + (20 * particleSize);
+            m_A(0, first + k) = m_centerCoordinate.x + r * cosines[k];
+            m_A(1, first + k) = m_centerCoordinate.y + r * sines[k];
+        }
     }
 
     return;
 }
 
+// .:[Snapshot Constructor]:.
+//          >> Rebuilds a particle from a ParticleState; consumes no random numbers
+Particle::Particle(RenderTarget& target, const ParticleState& state)
+    :m_A(2, state.numPoints)
+{
+    m_ttl = state.ttl;
+    m_lifetime = state.lifetime;
+    m_version = ++s_nextVersion;
+    m_numPoints = state.numPoints;
+    m_radiansPerSec = state.radiansPerSec;
+    m_cartesianPlane.setCenter(0, 0);
+    m_cartesianPlane.setSize(target.getSize().x, (-1.0) * target.getSize().y);
+    m_centerCoordinate = Vector2f(state.centerX, state.centerY);
+    m_vx = state.vx;
+    m_vy = state.vy;
+    m_scaleMultiplier = state.scaleMultiplier;
+    m_color1 = Color(state.color1);
+    m_color2 = Color(state.color2);
+    m_tintedColor1 = m_color1;
+    m_tintedColor2 = m_color2;
+
+    for (int j = 0; j < m_numPoints; ++j)
+    {
+        m_A(0, j) = state.points[j][0];
+        m_A(1, j) = state.points[j][1];
+    }
+}
+
+// .:[Save Particle State]:.
+//          >> Copies this particle into a flat ParticleState; derived types add their own fields
+void Particle::saveState(ParticleState& state) const
+{
+    state = ParticleState();
+    state.type = getType();
+    state.numPoints = (m_numPoints > MAX_POINTS) ? MAX_POINTS : m_numPoints;       // Larger fans lose their extra points
+    state.ttl = m_ttl;
+    state.lifetime = m_lifetime;
+    state.radiansPerSec = m_radiansPerSec;
+    state.vx = m_vx;
+    state.vy = m_vy;
+    state.scaleMultiplier = m_scaleMultiplier;
+    state.centerX = m_centerCoordinate.x;
+    state.centerY = m_centerCoordinate.y;
+    state.color1 = m_color1.toInteger();
+    state.color2 = m_color2.toInteger();
+
+    for (int j = 0; j < state.numPoints; ++j)
+    {
+        state.points[j][0] = m_A(0, j);
+        state.points[j][1] = m_A(1, j);
+    }
+}
+
+// .:[Particle Factory]:.
+//          >> Constructs the derived particle type recorded in a ParticleState
+Particle* Particle::fromState(RenderTarget& target, const ParticleState& state)
+{
+    switch (state.type)
+    {
+    case CONSTANT:
+        return new ConstantParticle(target, state);
+    case WAVE:
+        return new WaveParticle(target, state);
+    case GROW:
+        return new GrowParticle(target, state);
+    default:
+        return new Particle(target, state);
+    }
+}
+
+bool Particle::isValidState(const ParticleState& state)
+{
+    return state.type <= GROW && state.numPoints >= 2 && state.numPoints <= MAX_POINTS;
+}
+
+// .:[Particle State Factory]:.
+//          >> Follows the constructors step by step: Particle's draws (spin, velocity, colors, fan radii), then
+//          >> the derived constructor's (its own velocity, and a wave's directions), with their default arguments
+void Particle::randomState(ParticleType type, const RenderTarget& target, int numPoints, Vector2i mouseClickPosition,
+    Color particleColor, ParticleState& state)
+{
+    // Size and color each derived constructor hands to Particle's
+    float particleSize = 1.0;
+    if (type == CONSTANT || type == WAVE)
+    {
+        particleSize = 0.33;
+    }
+    if (type == WAVE)
+    {
+        particleColor = Color::Cyan;
+    }
+    else if (type == GROW)
+    {
+        particleSize = 0.5;
+        particleColor = Color::Yellow;
+    }
+
+    state = ParticleState();
+    state.type = type;
+    state.numPoints = (numPoints > MAX_POINTS) ? MAX_POINTS : numPoints;
+    state.ttl = TTL;
+    state.lifetime = TTL;
+    state.radiansPerSec = ((float)rand() / (RAND_MAX)) * M_PI;
+    View cartesianPlane;
+    cartesianPlane.setCenter(0, 0);
+    cartesianPlane.setSize(target.getSize().x, (-1.0) * target.getSize().y);
+    Vector2f center = target.mapPixelToCoords(mouseClickPosition, cartesianPlane);
+    state.centerX = center.x;
+    state.centerY = center.y;
+    state.scaleMultiplier = SCALE;
+
+    float vx = rand() % 401 + 100;
+    if (rand() % 2 == 0) { vx *= -1; }
+    float vy = rand() % 401 + 100;
+
+    state.color1 = Color(150, 150, 150, 100).toInteger();
+    if (particleColor == Color::Black)
+    {
+        int r = rand() % 256;
+        int g = rand() % 256;
+        int b = (r + g < 40) ? rand() % 156 + 100 : rand() % 256;
+        particleColor = Color(r, g, b, 150);
+    }
+    state.color2 = particleColor.toInteger();
+
+    // Same fan as the constructor: fixed theta, one random radius per point
+    std::uniform_real_distribution<double> unif(0, M_PI / 2);
+    std::default_random_engine re;
+    real theta = unif(re);
+    real dTheta = 2 * M_PI / (numPoints - 1);
+    const int TRIG_BLOCK = 64;
+    real angles[TRIG_BLOCK], sines[TRIG_BLOCK], cosines[TRIG_BLOCK];
+    for (int first = 0; first < numPoints; first += TRIG_BLOCK)
+    {
+        int count = min(TRIG_BLOCK, numPoints - first);
+        for (int k = 0; k < count; ++k)
+        {
+            angles[k] = theta + (first + k) * dTheta;
+        }
+        sinCosBatch(angles, sines, cosines, count);
+
+        for (int k = 0; k < count; ++k)
+        {
+            real r = rand() % int(61 * particleSize) + (20 * particleSize);
+            if (first + k < MAX_POINTS)
+            {
+                state.points[first + k][0] = (real)center.x + r * cosines[k];
+                state.points[first + k][1] = (real)center.y + r * sines[k];
+            }
+        }
+    }
+
+    if (type == CONSTANT || type == WAVE)
+    {
+        vx = rand() % 201;
+        if (rand() % 2 == 0) { vx *= -1; }
+        vy = (rand() % 101 + 50) * -1;
+        state.scaleMultiplier = 1.0;
+        state.ttl = 10.0;
+        state.lifetime = 10.0;
+    }
+    if (type == WAVE)
+    {
+        vx = rand() % 101;
+        if (rand() % 2 == 0) { vx *= -1; }
+        vy = (rand() % 201 + 100) * -1;
+        state.wave.speed = 10.0;
+        state.wave.widthX = 15000.0;
+        state.wave.widthY = 0.0;
+        state.wave.globalVelocityX = vx;
+        state.wave.globalVelocityY = vy;
+        state.wave.directionX = (rand() % 2) != 0;
+        state.wave.directionY = (rand() % 2) != 0;
+    }
+    else if (type == GROW)
+    {
+        vx = rand() % 301;
+        if (rand() % 2 == 0) { vx *= -1; }
+        vy = rand() % 401 + 100;
+        state.scaleMultiplier = 1.002;
+        state.grow.growAmount = 0.0;
+        state.grow.maxGrow = 0.3;
+    }
+    state.vx = vx;
+    state.vy = vy;
+}
+
 // .:[Particle Draw Function]:.
 //          >> Called every frame by Engine loop
 void Particle::draw(RenderTarget& target, RenderStates states) const                    // Overrides Drawable class's draw() function for Polymorphism
@@ -93,14 +293,14 @@ void Particle::draw(RenderTarget& target, RenderStates states) const
 
     // Saves center data to VertexArray's center pixel
     lines[0].position = Vector2f(center.x, center.y);
-    lines[0].color = m_color1;
+    lines[0].color = m_tintedColor1;
 
     // Loops through every exterior point to set their respective positions and color
     for (int j = 1; j <= m_numPoints; j++)
     {
         Vector2i pixelPos = target.mapCoordsToPixel(Vector2f(m_A(0, j - 1), m_A(1, j - 1)), m_cartesianPlane);
         lines[j].position = Vector2f(pixelPos.x, pixelPos.y);
-        lines[j].color = m_color2;
+        lines[j].color = m_tintedColor2;
     }
 
     // Draws the VertexArray, now that it's set up
@@ -109,22 +309,58 @@ void Particle::draw(RenderTarget& target, RenderStates states) const
     return;
 }
 
+// .:[Particle Fan Mapping]:.
+//          >> Same screen positions draw() uses, written to a caller-owned array of getNumPoints() + 1 points
+void Particle::mapFan(const RenderTarget& target, Vector2f* points) const
+{
+    Vector2i center = target.mapCoordsToPixel(m_centerCoordinate, m_cartesianPlane);
+    points[0] = Vector2f(center.x, center.y);
+
+    for (int j = 1; j <= m_numPoints; j++)
+    {
+        Vector2i pixelPos = target.mapCoordsToPixel(Vector2f(m_A(0, j - 1), m_A(1, j - 1)), m_cartesianPlane);
+        points[j] = Vector2f(pixelPos.x, pixelPos.y);
+    }
+}
+
+// .:[Particle Tint]:.
+//          >> Only a changed tint touches the drawn colors and the version
+void Particle::setTint(const Color& tint)
+{
+    if (tint == m_tint)
+    {
+        return;
+    }
+    m_tint = tint;
+    m_tintedColor1 = m_color1 * tint;
+    m_tintedColor2 = m_color2 * tint;
+    m_version = ++s_nextVersion;
+}
+
 // .:[Particle Physics Updates]:.
 //          >> Called every frame by Engine loop
+//          >> Gravity and every other force now comes from the Engine's ForceFieldStack before this runs
 void Particle::update(float dt)
 {
-    // Assigns vertical velocity of the particle according to Gravity constant
-    m_vy = m_vy - (G * dt);
     // Goes ahead with transform update
     transformUpdate(dt);
     return;
 }
 
+// .:[Particle Acceleration]:.
+//          >> Force fields hand their summed acceleration over here, once per step
+void Particle::accelerate(float ax, float ay, float dt)
+{
+    m_vx += ax * dt;
+    m_vy += ay * dt;
+}
+
 // .:[Particle Transform Update]:.
 //          >> Separated so derived particles can have different behaviors before updating
 void Particle::transformUpdate(float dt)
 {
     m_ttl = m_ttl - dt;                         // Decreases time to live
+    m_version = ++s_nextVersion;                // Geometry is about to change
     rotate(dt * m_radiansPerSec);               // Rotation
     if (!almostEqual(m_scaleMultiplier, 1.0))
     {
@@ -294,7 +530,7 @@ void Particle::unitTests()
 
 // .:[Particle Rotation]:.
 //          >> Rotate Particle by theta radians counter-clockwise
-void Particle::rotate(double theta)
+void Particle::rotate(real theta)
 {
     Vector2f temp = m_centerCoordinate;                             // Temporarily store coordinates
     translate(-m_centerCoordinate.x, -m_centerCoordinate.y);        // Move particle to the origin so it pivots correctly
@@ -305,7 +541,7 @@ void Particle::rotate(double theta)
 
 ///Scale the size of the Particle by factor c
 ///construct a ScalingMatrix S, left multiply it to m_A
-void Particle::scale(double c)
+void Particle::scale(real c)
 {
     //Stores m_centerCoordinate inside a Vector2f
     Vector2f temp = m_centerCoordinate;
@@ -323,7 +559,7 @@ void Particle::scale(double c)
 
 ///shift the Particle by (xShift, yShift) coordinates
 ///construct a TranslationMatrix T, add it to m_A
-void Particle::translate(double xShift, double yShift)
+void Particle::translate(real xShift, real yShift)
 {
     //Creates a Translation matrix T which will be used to move m_A
     TranslationMatrix T(xShift, yShift, m_A.getCols());
@@ -411,6 +647,47 @@ WaveParticle::WaveParticle(RenderTarget& target, int numPoints, Vector2i mouseCl
     return;
 }
 
+// .:[Wave Particle Snapshot Constructor]:.
+WaveParticle::WaveParticle(RenderTarget& target, const ParticleState& state)
+    : ConstantParticle(target, state)
+{
+    w_waveSpeed = state.wave.speed;
+    w_waveWidthX = state.wave.widthX;
+    w_waveWidthY = state.wave.widthY;
+    waveVelocityX = state.wave.velocityX;
+    waveVelocityY = state.wave.velocityY;
+    currentWaveWidthX = state.wave.currentWidthX;
+    currentWaveWidthY = state.wave.currentWidthY;
+    globalVelocityX = state.wave.globalVelocityX;
+    globalVelocityY = state.wave.globalVelocityY;
+    waveDirectionX = state.wave.directionX;
+    waveDirectionY = state.wave.directionY;
+}
+
+void WaveParticle::saveState(ParticleState& state) const
+{
+    Particle::saveState(state);
+    state.wave.speed = w_waveSpeed;
+    state.wave.widthX = w_waveWidthX;
+    state.wave.widthY = w_waveWidthY;
+    state.wave.velocityX = waveVelocityX;
+    state.wave.velocityY = waveVelocityY;
+    state.wave.currentWidthX = currentWaveWidthX;
+    state.wave.currentWidthY = currentWaveWidthY;
+    state.wave.globalVelocityX = globalVelocityX;
+    state.wave.globalVelocityY = globalVelocityY;
+    state.wave.directionX = waveDirectionX;
+    state.wave.directionY = waveDirectionY;
+}
+
+// .:[Wave Particle Acceleration]:.
+//          >> update() rebuilds the velocity from the global velocity every step, so forces steer that instead
+void WaveParticle::accelerate(float ax, float ay, float dt)
+{
+    globalVelocityX += ax * dt;
+    globalVelocityY += ay * dt;
+}
+
 // .:[Wave Particle Update]:.
 void WaveParticle::update(float dt)
 {
@@ -500,6 +777,20 @@ GrowParticle::GrowParticle(RenderTarget& target, int numPoints, Vector2i mouseCl
     return;
 }
 
+GrowParticle::GrowParticle(RenderTarget& target, const ParticleState& state)
+    : Particle(target, state)
+{
+    growAmount = state.grow.growAmount;
+    g_maxGrow = state.grow.maxGrow;
+}
+
+void GrowParticle::saveState(ParticleState& state) const
+{
+    Particle::saveState(state);
+    state.grow.growAmount = growAmount;
+    state.grow.maxGrow = g_maxGrow;
+}
+
 void GrowParticle::update(float dt)
 {
     //cout << growAmount << endl;
@@ -514,8 +805,6 @@ void GrowParticle::update(float dt)
         }
     }
 
-
-    // Assigns vertical velocity of the particle according to Gravity constant
-    setVelocity(getVelocity().x, getVelocity().y - ((G / 2) * dt));
+    // Gravity at half strength comes from the force field stack
     transformUpdate(dt);
 }
\ No newline at end of file
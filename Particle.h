@@ -1,13 +1,54 @@
 #pragma once
 #include "Matrices.h"
 #include <SFML/Graphics.hpp>
+#include <cstdint>
 
 #define M_PI 3.1415926535897932384626433
-const float G = 1000;                               // Gravity
+const float G = 1000;                               // Gravity; applied by the Engine's force fields
 const float TTL = 5.0;                              // Time To Live
 const float SCALE = 0.99999;                          // Scale
 
-enum ParticleType {RANDOM, NORMAL, CONSTANT};       // Enumerator to assist with spawning
+enum ParticleType {RANDOM, NORMAL, CONSTANT, WAVE, GROW};       // Enumerator to assist with spawning
+const int MAX_POINTS = 64;                          // Largest fan a ParticleState can hold; Engine spawns 25-50 points
+
+// .:[Particle State]:.
+//          >> Flat, fixed-size copy of everything a particle needs, so whole scenes can be written out and mapped back in place
+struct WaveState
+{
+    float speed;
+    float widthX, widthY;
+    float velocityX, velocityY;
+    float currentWidthX, currentWidthY;
+    float globalVelocityX, globalVelocityY;
+    uint8_t directionX, directionY;
+    uint8_t padding[2];
+};
+
+struct GrowState
+{
+    float growAmount;
+    float maxGrow;
+};
+
+struct ParticleState
+{
+    uint8_t type;                       // ParticleType
+    uint8_t padding;
+    uint16_t numPoints;
+    float ttl;
+    float lifetime;                     // TTL the particle started with
+    float radiansPerSec;
+    float vx, vy;
+    float scaleMultiplier;
+    float centerX, centerY;
+    uint32_t color1, color2;            // Packed RGBA, see Color::toInteger()
+    union
+    {
+        WaveState wave;
+        GrowState grow;
+    };
+    float points[MAX_POINTS][2];        // Cartesian coordinates of the fan's outer points
+};
 
 using namespace Matrices;
 using namespace sf;
@@ -18,22 +59,62 @@ class Particle : public Drawable
 {
 public:
 	Particle(RenderTarget& target, int numPoints, Vector2i mouseClickPosition, float particleSize = 1.0, Color particleColor = Color::Black, float startingX = 0.0, float startingY = 0.0);
+    Particle(RenderTarget& target, const ParticleState& state);
+    virtual ~Particle() {}
+
+    //Heap copy with a fresh version, used to stamp out cached prototypes
+    virtual Particle* clone() const { return stampVersion(new Particle(*this)); }
 	virtual void draw(RenderTarget& target, RenderStates states) const override;
     virtual void update(float dt);
+    virtual void accelerate(float ax, float ay, float dt);
+    void displace(float dx, float dy) { m_version = ++s_nextVersion; translate(dx, dy); }      // Move without touching velocity
     void transformUpdate(float dt);
     float getTTL() { return m_ttl; }
-    Vector2f getVelocity() { return Vector2f(m_vx, m_vy); }
+    Vector2f getVelocity() const { return Vector2f(m_vx, m_vy); }
+    Vector2f getCenter() const { return m_centerCoordinate; }        // Cartesian: origin mid-window, y up
     void setVelocity(float set_x, float set_y) { m_vx = set_x; m_vy = set_y; }
     void setScaleMultiplier(float set_scale) { m_scaleMultiplier = set_scale; }
-    void setTTL(float set_ttl) { m_ttl = set_ttl; }
+    void setTTL(float set_ttl) { m_ttl = set_ttl; m_lifetime = set_ttl; }     // Also restarts the color ramp
     float getScaleMultiplier() { return m_scaleMultiplier; }
 
+    //Share of the lifetime used up, 0 at spawn to 1 at expiry
+    float getLife() const { return (m_lifetime > 0.0f) ? 1.0f - m_ttl / m_lifetime : 1.0f; }
+
+    //Color-over-life tint, multiplied into both fan colors
+    Color getTint() const { return m_tint; }
+    void setTint(const Color& tint);
+
+    //Fan geometry for draw backends other than SFML: center followed by getNumPoints() rim points, in pixel coordinates
+    int getNumPoints() const { return m_numPoints; }
+    Color getCenterColor() const { return m_tintedColor1; }
+    Color getOuterColor() const { return m_tintedColor2; }
+    void mapFan(const RenderTarget& target, Vector2f* points) const;
+    Vector2f mapPoint(const RenderTarget& target, Vector2f coordinate) const { return Vector2f(target.mapCoordsToPixel(coordinate, m_cartesianPlane)); }
+
+    //Changes whenever the fan's shape, position or colors change; unique across all particles, never reused
+    uint64_t getVersion() const { return m_version; }
+
+    //Snapshot support; fromState() rebuilds the right derived type
+    virtual ParticleType getType() const { return NORMAL; }
+    virtual void saveState(ParticleState& state) const;
+    static Particle* fromState(RenderTarget& target, const ParticleState& state);
+
+    //False for a state fromState() must not be given: an unknown type, or a fan of fewer than 2 or more than MAX_POINTS
+    //points. Anything read from a file or the network goes through this first
+    static bool isValidState(const ParticleState& state);
+
+    //The state a new particle of this type would save, drawing the same rand() numbers in the same order, without
+    //building it; particleColor is the constructor argument NORMAL and CONSTANT take, WAVE and GROW pick their own
+    static void randomState(ParticleType type, const RenderTarget& target, int numPoints, Vector2i mouseClickPosition,
+        Color particleColor, ParticleState& state);
+
     //Functions for unit testing
     bool almostEqual(double a, double b, double eps = 0.0001);
     void unitTests();
 
 private:
     float m_ttl;
+    float m_lifetime;
     int m_numPoints;
 	Vector2f m_centerCoordinate;
     float m_radiansPerSec;
@@ -43,19 +124,30 @@ private:
     View m_cartesianPlane;
     Color m_color1;
     Color m_color2;
+    Color m_tint = Color::White;
+    Color m_tintedColor1;               // m_color1 * m_tint, what actually gets drawn
+    Color m_tintedColor2;
     Matrix m_A;
+    uint64_t m_version;
+
+    static uint64_t s_nextVersion;
+
+protected:
+    static Particle* stampVersion(Particle* particle) { particle->m_version = ++s_nextVersion; return particle; }
+
+private:
 
     ///rotate Particle by theta radians counter-clockwise
     ///construct a RotationMatrix R, left mulitply it to m_A
-    void rotate(double theta);
+    void rotate(real theta);
 
     ///Scale the size of the Particle by factor c
     ///construct a ScalingMatrix S, left multiply it to m_A
-    void scale(double c);
+    void scale(real c);
 
     ///shift the Particle by (xShift, yShift) coordinates
     ///construct a TranslationMatrix T, add it to m_A
-    void translate(double xShift, double yShift);
+    void translate(real xShift, real yShift);
 };
 
 // .:[Constant Particle]:.
@@ -64,7 +156,10 @@ class ConstantParticle : public Particle
 {
 public:
     ConstantParticle(RenderTarget& target, int numPoints, Vector2i mouseClickPosition, Color particleColor = Color::Black, float startingX = 0.0, float startingY = 0.0);
+    ConstantParticle(RenderTarget& target, const ParticleState& state) : Particle(target, state) {}
+    Particle* clone() const override { return stampVersion(new ConstantParticle(*this)); }
     void update(float dt) override;
+    ParticleType getType() const override { return CONSTANT; }
 };
 
 // .:[Wave Particle]:.
@@ -74,7 +169,12 @@ class WaveParticle : public ConstantParticle
 public:
     WaveParticle(RenderTarget& target, int numPoints, Vector2i mouseClickPosition, float waveWidthX = 15000.0, float waveWidthY = 0.0, float waveSpeed = 10.0, 
         Color particleColor = Color::Black, float startingX = 0.0, float startingY = 0.0);
+    WaveParticle(RenderTarget& target, const ParticleState& state);
+    Particle* clone() const override { return stampVersion(new WaveParticle(*this)); }
     void update(float dt) override;
+    void accelerate(float ax, float ay, float dt) override;
+    ParticleType getType() const override { return WAVE; }
+    void saveState(ParticleState& state) const override;
 private:
     float w_waveSpeed;                  // Speed that the wave will accelerate and decelerate
     float w_waveWidthX;                 // Width of the wave on both axes
@@ -95,7 +195,11 @@ class GrowParticle : public Particle
 {
 public:
     GrowParticle(RenderTarget& target, int numPoints, Vector2i mouseClickPosition, float growScale = 1.002, float maxGrow = 0.3, Color particleColor = Color::Black, float startingX = 0.0, float startingY = 0.0);
+    GrowParticle(RenderTarget& target, const ParticleState& state);
+    Particle* clone() const override { return stampVersion(new GrowParticle(*this)); }
     void update(float dt) override;
+    ParticleType getType() const override { return GROW; }
+    void saveState(ParticleState& state) const override;
 private:
     float growAmount;
     float g_maxGrow;
@@ -0,0 +1,195 @@
+#include "ParticleBatch.h"
+#include <algorithm>
+#include <cmath>
+
+const size_t MERGE_GAP = 256;           // Dirty ranges closer than this many vertices are uploaded together
+const int FILL_GRAIN = 256;             // Particles per vertex fill job
+const float TRAIL_WIDTH = 3.0f;         // Half width of a trail where it meets its particle, in pixels
+
+ParticleBatch::ParticleBatch(ThreadPool& threadPool)
+	: m_threadPool(threadPool), m_buffer(Triangles, VertexBuffer::Stream), m_scratch(threadPool.getThreadCount())
+{
+}
+
+// .:[Batch Update]:.
+//          >> Three passes: a serial prefix sum over point counts that also decides which slots are dirty,
+//          >> a parallel fill where each worker writes only its own particles' vertex ranges,
+//          >> and a serial merge of the dirty ranges into uploads
+void ParticleBatch::update(const vector<Particle*>& particles, const TrailSlab* trails, const RenderTarget& target)
+{
+	// Work out the packed layout first, so the buffer can grow before anything is written
+	size_t count = particles.size();
+	m_offsets.resize(count + 1);
+	m_offsets[0] = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t trailVertices = trails ? 6 * max(0, trails->getCount(i) - 1) : 0;
+		m_offsets[i + 1] = m_offsets[i] + trailVertices + 3 * max(0, particles[i]->getNumPoints() - 1);
+	}
+	size_t vertexCount = m_offsets[count];
+
+	bool reallocated = false;
+	if (vertexCount > m_capacity)
+	{
+		m_capacity = max(vertexCount, m_capacity * 2);
+		m_vertices.resize(m_capacity);
+		if (VertexBuffer::isAvailable())
+		{
+			m_buffer.create(m_capacity);
+		}
+		reallocated = true;
+	}
+
+	// Every slot whose particle, version or offset differs from what was uploaded gets rewritten
+	m_dirty.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const Particle* particle = particles[i];
+		uint32_t trailStamp = trails ? trails->getStamp(i) : 0;
+		m_dirty[i] = reallocated || i >= m_slots.size() || m_slots[i].particle != particle
+			|| m_slots[i].version != particle->getVersion() || m_slots[i].trailStamp != trailStamp
+			|| m_slots[i].offset != m_offsets[i];
+	}
+
+	// >> Ranges never overlap, so workers need no locks. Each thread reuses its own scratch from earlier frames,
+	//    so the fill allocates nothing once the scratch has grown to the longest trail or fan
+	m_threadPool.parallelFor((int)count, [&](int begin, int end, int worker)
+	{
+		vector<Vector2f>& fan = m_scratch[worker];
+		for (int i = begin; i < end; i++)
+		{
+			if (m_dirty[i])
+			{
+				Vertex* out = &m_vertices[m_offsets[i]];
+				if (trails && trails->getCount(i) > 1)
+				{
+					writeTrail(*particles[i], *trails, i, target, fan, out);
+					out += 6 * (trails->getCount(i) - 1);
+				}
+				writeFan(*particles[i], target, fan, out);
+			}
+		}
+	}, FILL_GRAIN);
+
+	m_slots.resize(count);
+	m_ranges.clear();
+	size_t dirtyVertices = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		m_slots[i] = { particles[i], particles[i]->getVersion(), trails ? trails->getStamp(i) : 0, m_offsets[i] };
+		if (!m_dirty[i])
+		{
+			continue;
+		}
+		size_t offset = m_offsets[i];
+		if (!m_ranges.empty() && offset <= m_ranges.back().second + MERGE_GAP)
+		{
+			dirtyVertices += m_offsets[i + 1] - m_ranges.back().second;
+			m_ranges.back().second = m_offsets[i + 1];
+		}
+		else
+		{
+			m_ranges.push_back(make_pair(offset, m_offsets[i + 1]));
+			dirtyVertices += m_offsets[i + 1] - offset;
+		}
+	}
+	m_vertexCount = vertexCount;
+	m_uploadedVertices = 0;
+
+	if (!VertexBuffer::isAvailable() || m_ranges.empty())
+	{
+		return;
+	}
+
+	// Mostly dirty: re-specify the whole buffer (orphaning it) instead of patching it
+	if (reallocated || dirtyVertices * 2 > m_capacity)
+	{
+		m_buffer.update(m_vertices.data(), m_capacity, 0);
+		m_uploadedVertices = m_capacity;
+		return;
+	}
+	for (const pair<size_t, size_t>& range : m_ranges)
+	{
+		m_buffer.update(&m_vertices[range.first], range.second - range.first, (unsigned int)range.first);
+		m_uploadedVertices += range.second - range.first;
+	}
+}
+
+void ParticleBatch::draw(RenderTarget& target, RenderStates states) const
+{
+	if (m_vertexCount == 0)
+	{
+		return;
+	}
+	if (VertexBuffer::isAvailable())
+	{
+		target.draw(m_buffer, 0, m_vertexCount, states);
+	}
+	else
+	{
+		target.draw(m_vertices.data(), m_vertexCount, Triangles, states);
+	}
+}
+
+// .:[Fan Vertices]:.
+//          >> Turns the fan into a triangle list, center color at the hub and outer color on the rim.
+//          >> Runs on worker threads: touches only the particle, the calling thread's scratch and out
+void ParticleBatch::writeFan(const Particle& particle, const RenderTarget& target, vector<Vector2f>& fan, Vertex* out)
+{
+	int numPoints = particle.getNumPoints();
+	fan.resize(numPoints + 1);
+	particle.mapFan(target, fan.data());
+
+	Color center = particle.getCenterColor();
+	Color outer = particle.getOuterColor();
+	for (int j = 1; j < numPoints; j++)
+	{
+		*out++ = Vertex(fan[0], center);
+		*out++ = Vertex(fan[j], outer);
+		*out++ = Vertex(fan[j + 1], outer);
+	}
+}
+
+// .:[Trail Vertices]:.
+//          >> Each point is pushed out both ways along the normal of the segment leaving it (the last point
+//          >> reuses the one before); width and alpha both grow linearly from the oldest point to the newest.
+//          >> A particle that hasn't moved gives zero-length segments, which just come out as empty triangles
+void ParticleBatch::writeTrail(const Particle& particle, const TrailSlab& trails, size_t index, const RenderTarget& target,
+	vector<Vector2f>& points, Vertex* out)
+{
+	int count = trails.getCount(index);
+	points.resize(count);
+	for (int age = 0; age < count; age++)
+	{
+		points[age] = particle.mapPoint(target, trails.getPoint(index, age));
+	}
+
+	Color color = particle.getOuterColor();
+	Vector2f normal;
+	Vertex left, right;
+	for (int age = 0; age < count; age++)
+	{
+		if (age + 1 < count)
+		{
+			Vector2f direction = points[age + 1] - points[age];
+			float length = sqrtf(direction.x * direction.x + direction.y * direction.y);
+			normal = (length > 0.0f) ? Vector2f(-direction.y / length, direction.x / length) : Vector2f(0.0f, 0.0f);
+		}
+		float weight = (float)age / (count - 1);
+		Color faded = color;
+		faded.a = (Uint8)(color.a * weight);
+		Vertex nextLeft(points[age] + normal * (TRAIL_WIDTH * weight), faded);
+		Vertex nextRight(points[age] - normal * (TRAIL_WIDTH * weight), faded);
+		if (age > 0)
+		{
+			*out++ = left;
+			*out++ = right;
+			*out++ = nextLeft;
+			*out++ = nextLeft;
+			*out++ = right;
+			*out++ = nextRight;
+		}
+		left = nextLeft;
+		right = nextRight;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Particle.h"
+#include "ThreadPool.h"
+#include "TrailSlab.h"
+
+using namespace sf;
+using namespace std;
+
+// .:[Particle Batch]:.
+//          >> Draws every particle fan with one draw call from a persistent sf::VertexBuffer (Stream usage).
+//          >> Fans are packed back to back as triangle lists, 3 * (numPoints - 1) vertices each. Each frame only the
+//          >> particles whose version changed, or whose slot moved because something before them spawned or died,
+//          >> are rewritten and uploaded; neighbouring dirty ranges are merged into one upload.
+//          >> When most of the buffer is dirty it is re-specified from offset 0, which SFML turns into a
+//          >> glBufferData orphan, so the driver never waits on a buffer the GPU is still reading.
+//          >> Capacity grows geometrically and is never shrunk.
+//          >> Vertex generation for dirty particles is split across the thread pool; only the upload and the
+//          >> draw call stay on the calling thread.
+//          >> With trails on, each particle's slot starts with its trail: a strip tapering from nothing at the
+//          >> oldest point to full width at the particle, fading out with age, unrolled into the same
+//          >> triangle list (6 vertices per segment) so trails cost no extra draw call.
+class ParticleBatch
+{
+public:
+    explicit ParticleBatch(ThreadPool& threadPool);
+
+    ///Rebuild the dirty parts of the vertex data and upload them; trails, when given, run parallel to particles
+    void update(const vector<Particle*>& particles, const TrailSlab* trails, const RenderTarget& target);
+
+    void draw(RenderTarget& target, RenderStates states = RenderStates::Default) const;
+
+    size_t getVertexCount() const { return m_vertexCount; }
+    size_t getUploadedVertices() const { return m_uploadedVertices; }    // Last frame's upload, for profiling
+
+private:
+    struct Slot
+    {
+        const Particle* particle;
+        uint64_t version;
+        uint32_t trailStamp;
+        size_t offset;
+    };
+
+    ThreadPool& m_threadPool;
+    VertexBuffer m_buffer;
+    size_t m_capacity = 0;              // Vertices allocated in m_buffer
+    vector<Vertex> m_vertices;          // CPU copy of the whole buffer
+    vector<Slot> m_slots;               // What each slot held when last uploaded
+    vector<size_t> m_offsets;           // Prefix sum of vertex counts; particle i owns [m_offsets[i], m_offsets[i + 1])
+    vector<uint8_t> m_dirty;
+    vector<pair<size_t, size_t>> m_ranges;      // Dirty [begin, end) vertex ranges, merged for upload
+    vector<vector<Vector2f>> m_scratch;         // One fan/trail scratch per pool thread, kept between frames
+    size_t m_vertexCount = 0;
+    size_t m_uploadedVertices = 0;
+
+    void writeFan(const Particle& particle, const RenderTarget& target, vector<Vector2f>& fan, Vertex* out);
+    void writeTrail(const Particle& particle, const TrailSlab& trails, size_t index, const RenderTarget& target,
+        vector<Vector2f>& points, Vertex* out);
+};
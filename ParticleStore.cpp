@@ -0,0 +1,321 @@
+#include "ParticleStore.h"
+#include <algorithm>
+#include <cmath>
+
+const double WHEEL_TICK = 1.0 / 64.0;      // Seconds per level 0 slot
+const int LEVEL0_BITS = 8;
+const int LEVEL0_SLOTS = 1 << LEVEL0_BITS;
+const int LEVEL1_SLOTS = 64;
+const int OVERFLOW_SLOT = LEVEL0_SLOTS + LEVEL1_SLOTS;
+const size_t SORT_WINDOW = 16384;          // Particles placed per frame during a sweep
+const int SORT_INTERVAL = 120;             // Frames between sweeps when nothing else triggers one
+const float SORT_DISORDER = 0.3f;
+const size_t DISORDER_SAMPLES = 256;
+const uint32_t NO_RANK = UINT32_MAX;
+
+static int64_t toTick(double time)
+{
+	return (int64_t)floor(time / WHEEL_TICK);
+}
+
+ParticleStore::ParticleStore()
+	: m_slots(OVERFLOW_SLOT + 1)
+{
+}
+
+ParticleStore::~ParticleStore()
+{
+	clear();
+}
+
+void ParticleStore::add(Particle* particle, double birthTime)
+{
+	uint32_t index = (uint32_t)m_particles.size();
+	m_particles.push_back(particle);
+	m_records.push_back({ birthTime + particle->getTTL(), -1, 0, NO_RANK });
+	m_trails.add(m_trailLengths[particle->getType()]);
+	m_typeCounts[particle->getType()]++;
+	m_addedTotal++;
+	schedule(index, toTick(m_records[index].deathTime));
+}
+
+void ParticleStore::reserve(size_t count)
+{
+	m_particles.reserve(count);
+	m_records.reserve(count);
+	m_trails.reserve(count);
+}
+
+// .:[Swap Remove]:.
+//          >> The last particle fills the hole, and its wheel entry is pointed at the new index
+void ParticleStore::remove(size_t index)
+{
+	unschedule((uint32_t)index);
+	m_typeCounts[m_particles[index]->getType()]--;
+	delete m_particles[index];
+	if (isSorting() && m_records[index].rank != NO_RANK)
+	{
+		m_rankIndex[m_records[index].rank] = NO_RANK;
+	}
+
+	size_t last = m_particles.size() - 1;
+	if (index != last)
+	{
+		m_particles[index] = m_particles[last];
+		m_records[index] = m_records[last];
+		track(index);
+	}
+	m_particles.pop_back();
+	m_records.pop_back();
+	m_trails.remove(index);
+}
+
+// .:[Expire]:.
+//          >> Every tick before now's tick is entirely due. Now's own tick is only partly due,
+//          >> so its slot is filtered by exact death time and may be visited again next frame.
+size_t ParticleStore::expire(double now)
+{
+	size_t before = m_particles.size();
+	int64_t nowTick = toTick(now);
+
+	while (m_currentTick < nowTick)
+	{
+		vector<Entry>& slot = m_slots[m_currentTick & (LEVEL0_SLOTS - 1)];
+		while (!slot.empty())
+		{
+			remove(slot.back().storeIndex);
+		}
+		++m_currentTick;
+		if ((m_currentTick & (LEVEL0_SLOTS - 1)) == 0)
+		{
+			cascade();
+		}
+	}
+
+	vector<Entry>& slot = m_slots[m_currentTick & (LEVEL0_SLOTS - 1)];
+	for (size_t i = slot.size(); i-- > 0;)
+	{
+		// remove() swaps the slot's last entry into i, which has already been checked
+		if (m_records[slot[i].storeIndex].deathTime <= now)
+		{
+			remove(slot[i].storeIndex);
+		}
+	}
+	return before - m_particles.size();
+}
+
+// .:[Cull]:.
+//          >> Removing in descending index order keeps the remaining chosen indices valid,
+//          >> since each swap only pulls in a particle from further back
+void ParticleStore::cullSoonest(size_t count)
+{
+	count = min(count, m_particles.size());
+	if (count == 0)
+	{
+		return;
+	}
+
+	m_cullScratch.resize(m_particles.size());
+	for (size_t i = 0; i < m_cullScratch.size(); ++i)
+	{
+		m_cullScratch[i] = (uint32_t)i;
+	}
+	nth_element(m_cullScratch.begin(), m_cullScratch.begin() + (count - 1), m_cullScratch.end(),
+		[this](uint32_t a, uint32_t b) { return m_records[a].deathTime < m_records[b].deathTime; });
+	sort(m_cullScratch.begin(), m_cullScratch.begin() + count, greater<uint32_t>());
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		remove(m_cullScratch[i]);
+	}
+}
+
+void ParticleStore::clear()
+{
+	for (Particle* particle : m_particles)
+	{
+		delete particle;
+	}
+	m_particles.clear();
+	m_records.clear();
+	m_trails.clear();
+	fill(m_typeCounts, m_typeCounts + GROW + 1, 0);
+	for (vector<Entry>& slot : m_slots)
+	{
+		slot.clear();
+	}
+	m_rankIndex.clear();
+	m_sweepRank = SIZE_MAX;
+	m_sweepPosition = 0;
+	m_framesSinceSweep = 0;
+}
+
+void ParticleStore::recordTrails()
+{
+	for (size_t i = 0; i < m_particles.size(); i++)
+	{
+		m_trails.record(i, m_particles[i]->getCenter());
+	}
+}
+
+// .:[Spatial Sort Sweep]:.
+//          >> Placing rank r swaps whichever particle holds its target index out to where rank r was, so each
+//          >> frame costs at most SORT_WINDOW swaps. A particle whose rank died is skipped, and one a swap-remove
+//          >> has already pulled in front of the sweep stays there; either way the order is off by one particle
+void ParticleStore::sortSpatial(ThreadPool& threadPool)
+{
+	if (!isSorting())
+	{
+		if (++m_framesSinceSweep < SORT_INTERVAL && measureDisorder() < SORT_DISORDER)
+		{
+			return;
+		}
+		m_framesSinceSweep = 0;
+		if (m_particles.size() < 2)
+		{
+			return;
+		}
+		startSweep(threadPool);
+	}
+
+	size_t placed = 0;
+	while (placed < SORT_WINDOW && m_sweepRank < m_rankIndex.size() && m_sweepPosition < m_particles.size())
+	{
+		uint32_t index = m_rankIndex[m_sweepRank++];
+		if (index == NO_RANK || index < m_sweepPosition)
+		{
+			continue;
+		}
+		swapParticles(index, m_sweepPosition++);
+		placed++;
+	}
+	if (m_sweepRank >= m_rankIndex.size() || m_sweepPosition >= m_particles.size())
+	{
+		m_sweepRank = SIZE_MAX;
+		m_rankIndex.clear();
+	}
+}
+
+float ParticleStore::measureDisorder() const
+{
+	if (m_particles.size() < 2)
+	{
+		return 0.0f;
+	}
+	size_t pairs = m_particles.size() - 1;
+	size_t samples = min(pairs, DISORDER_SAMPLES);
+	size_t outOfOrder = 0;
+	for (size_t s = 0; s < samples; s++)
+	{
+		size_t i = s * pairs / samples;
+		outOfOrder += mortonCode(m_particles[i]->getCenter()) > mortonCode(m_particles[i + 1]->getCenter());
+	}
+	return (float)outOfOrder / samples;
+}
+
+// .:[Sweep Start]:.
+//          >> The one pass over the whole store: every key is computed and radix-sorted in parallel, and each
+//          >> record learns its rank. Records are written by exactly one job each, so the pass splits without locks
+void ParticleStore::startSweep(ThreadPool& threadPool)
+{
+	const vector<uint32_t>& order = m_sorter.sort(threadPool, m_particles.data(), m_particles.size());
+	m_rankIndex.assign(order.begin(), order.end());
+	threadPool.parallelFor((int)m_rankIndex.size(), [&](int begin, int end)
+	{
+		for (int j = begin; j < end; j++)
+		{
+			m_records[m_rankIndex[j]].rank = (uint32_t)j;
+		}
+	});
+	m_sweepRank = 0;
+	m_sweepPosition = 0;
+}
+
+// .:[Swap]:.
+//          >> Particles, records and trails move together, and both records re-point what refers to them
+void ParticleStore::swapParticles(size_t a, size_t b)
+{
+	swap(m_particles[a], m_particles[b]);
+	swap(m_records[a], m_records[b]);
+	m_trails.swap(a, b);
+	track(a);
+	track(b);
+}
+
+// .:[Track]:.
+//          >> Points the wheel entry, and during a sweep the rank table, at the particle now at index
+void ParticleStore::track(size_t index)
+{
+	const Record& record = m_records[index];
+	m_slots[record.slot][record.position].storeIndex = (uint32_t)index;
+	if (isSorting() && record.rank != NO_RANK)
+	{
+		m_rankIndex[record.rank] = (uint32_t)index;
+	}
+}
+
+// .:[Schedule]:.
+//          >> Anything already due goes in the current slot so the next expire() catches it
+void ParticleStore::schedule(uint32_t storeIndex, int64_t deathTick)
+{
+	deathTick = max(deathTick, m_currentTick);
+	int64_t blocksAhead = (deathTick >> LEVEL0_BITS) - (m_currentTick >> LEVEL0_BITS);
+
+	int slot;
+	if (deathTick - m_currentTick < LEVEL0_SLOTS)
+	{
+		slot = (int)(deathTick & (LEVEL0_SLOTS - 1));
+	}
+	else if (blocksAhead <= LEVEL1_SLOTS)
+	{
+		// A block exactly LEVEL1_SLOTS ahead shares the current block's slot, which was already cascaded
+		slot = LEVEL0_SLOTS + (int)((deathTick >> LEVEL0_BITS) & (LEVEL1_SLOTS - 1));
+	}
+	else
+	{
+		slot = OVERFLOW_SLOT;
+	}
+
+	m_records[storeIndex].slot = slot;
+	m_records[storeIndex].position = (uint32_t)m_slots[slot].size();
+	m_slots[slot].push_back({ storeIndex, deathTick });
+}
+
+void ParticleStore::unschedule(uint32_t storeIndex)
+{
+	Record& record = m_records[storeIndex];
+	vector<Entry>& slot = m_slots[record.slot];
+	if (record.position != slot.size() - 1)
+	{
+		slot[record.position] = slot.back();
+		m_records[slot[record.position].storeIndex].position = record.position;
+	}
+	slot.pop_back();
+}
+
+// .:[Cascade]:.
+//          >> Called each time level 0 wraps: the overflow is re-placed first so anything now in range lands
+//          >> in level 1, then the level 1 slot for the block just starting is spread over level 0
+void ParticleStore::cascade()
+{
+	vector<Entry> moving;
+	if (!m_slots[OVERFLOW_SLOT].empty())
+	{
+		moving.swap(m_slots[OVERFLOW_SLOT]);
+		for (const Entry& entry : moving)
+		{
+			schedule(entry.storeIndex, entry.deathTick);
+		}
+		moving.clear();
+	}
+
+	int slot = LEVEL0_SLOTS + (int)((m_currentTick >> LEVEL0_BITS) & (LEVEL1_SLOTS - 1));
+	if (!m_slots[slot].empty())
+	{
+		moving.swap(m_slots[slot]);
+		for (const Entry& entry : moving)
+		{
+			schedule(entry.storeIndex, entry.deathTick);
+		}
+	}
+}
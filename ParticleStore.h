@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Particle.h"
+#include "TrailSlab.h"
+#include "SpatialSort.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// .:[Particle Store]:.
+//          >> Owns every live particle. Particles sit densely in one vector, and removing one swaps the last
+//          >> particle into its place, so removal is O(1) but order is not preserved.
+//          >> Expiry is scheduled in a hierarchical timing wheel keyed on death time (spawn time + TTL):
+//          >>      level 0: 256 slots of 1/64 s, the next 4 seconds
+//          >>      level 1: 64 slots of 4 s, the next ~4 minutes, cascaded into level 0 every 4 seconds
+//          >>      overflow: anything later, re-examined every 4 seconds
+//          >> expire() only touches the slots whose time has come, instead of checking every particle's TTL.
+//          >> Each particle's record knows its wheel slot and each wheel entry knows its store index,
+//          >> so both sides stay O(1) when the other moves something.
+//          >> Trails live alongside in a TrailSlab with the same indices, sized per type at spawn.
+//          >> sortSpatial() keeps memory order close to screen order; particles are reordered by pointer, so
+//          >> Particle* handles held outside the store never change. A sweep radix-sorts the whole store's Morton
+//          >> codes once, then swaps particles into that order a window per frame. Each record carries its rank
+//          >> in the sort, and the sweep keeps a rank-to-index table that add and remove keep current, so spawns
+//          >> and deaths between frames never leave the sweep pointing at the wrong particle.
+class ParticleStore
+{
+public:
+    ParticleStore();
+    ~ParticleStore();
+    ParticleStore(const ParticleStore&) = delete;
+    ParticleStore& operator=(const ParticleStore&) = delete;
+
+    ///Take ownership and schedule the particle to die getTTL() seconds after birthTime
+    void add(Particle* particle, double birthTime);
+    void reserve(size_t count);
+
+    ///Delete the particle at index; the last particle moves into its place
+    void remove(size_t index);
+
+    ///Delete every particle whose death time is at or before now; now must not go backwards
+    size_t expire(double now);
+
+    ///Delete the count particles closest to their death time
+    void cullSoonest(size_t count);
+
+    ///Delete everything
+    void clear();
+
+    size_t size() const { return m_particles.size(); }
+    bool empty() const { return m_particles.empty(); }
+    Particle* operator[](size_t index) const { return m_particles[index]; }
+    vector<Particle*>::const_iterator begin() const { return m_particles.begin(); }
+    vector<Particle*>::const_iterator end() const { return m_particles.end(); }
+    const vector<Particle*>& getParticles() const { return m_particles; }
+
+    ///Live particles of one type, kept up to date by add and remove
+    size_t getTypeCount(ParticleType type) const { return m_typeCounts[type]; }
+
+    ///Particles ever added, for allocation rates
+    uint64_t getAddedTotal() const { return m_addedTotal; }
+
+    ///Particle slots the store has allocated room for
+    size_t getCapacity() const { return m_particles.capacity(); }
+
+    ///Trail length for particles of type added from now on; 0 (the default) gives them none
+    void setTrailLength(ParticleType type, int length) { m_trailLengths[type] = length; }
+
+    ///Push every particle's current center onto its trail
+    void recordTrails();
+    const TrailSlab& getTrails() const { return m_trails; }
+
+    ///Call once per frame. Every SORT_INTERVAL frames, or sooner once sampled disorder passes SORT_DISORDER,
+    ///starts a sweep that leaves the whole store in Morton order after about size() / SORT_WINDOW frames
+    void sortSpatial(ThreadPool& threadPool);
+
+    ///Share of sampled memory neighbours whose Morton codes descend: 0 for a store a sweep has just finished,
+    ///about 0.5 for a shuffled one. Each spawn, swap-remove or particle moving across a cell boundary breaks
+    ///the order in one or two places, so this grows with the drift since the last sweep
+    float measureDisorder() const;
+
+    ///True while a sweep is still placing particles
+    bool isSorting() const { return m_sweepRank != SIZE_MAX; }
+
+private:
+    struct Record
+    {
+        double deathTime;
+        int slot;
+        uint32_t position;              // Index inside m_slots[slot]
+        uint32_t rank;                  // Place in the current sweep's order; NO_RANK if spawned since it began
+    };
+
+    struct Entry
+    {
+        uint32_t storeIndex;
+        int64_t deathTick;
+    };
+
+    vector<Particle*> m_particles;
+    vector<Record> m_records;           // Parallel to m_particles
+    vector<vector<Entry>> m_slots;      // Level 0, then level 1, then the overflow slot
+    vector<uint32_t> m_cullScratch;
+    TrailSlab m_trails;                 // Parallel to m_particles
+    int m_trailLengths[GROW + 1] = {};
+    size_t m_typeCounts[GROW + 1] = {};
+    uint64_t m_addedTotal = 0;
+    int64_t m_currentTick = 0;
+
+    // Spatial sort sweep
+    MortonSorter m_sorter;
+    vector<uint32_t> m_rankIndex;       // Store index of the particle at each rank; NO_RANK once it has died
+    size_t m_sweepRank = SIZE_MAX;      // Next rank to place; SIZE_MAX between sweeps
+    size_t m_sweepPosition = 0;         // Index the next placed particle goes to; the store is in order before it
+    int m_framesSinceSweep = 0;
+
+    void schedule(uint32_t storeIndex, int64_t deathTick);
+    void unschedule(uint32_t storeIndex);
+    void cascade();
+    void startSweep(ThreadPool& threadPool);
+    void swapParticles(size_t a, size_t b);
+    void track(size_t index);
+};
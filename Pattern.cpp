@@ -0,0 +1,329 @@
+#include "Pattern.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+const int OUTLINE_SAMPLES = 256;        // Segments per curve in getOutlines()
+
+// Built-in copy of patterns.txt, used when the file is missing
+static const char* DEFAULT_PATTERNS =
+	"wave     25 circle 0.5  0.5   0  -150  300 18\n"
+	"wave     30 hline  0.5  0.5   0  -150  40 305\n"
+	"wave     30 vline  0.5  0.5   0  -150  30 305\n"
+	"wave     25 rose   0.5  0.5   0  -150  150 5 99\n"
+	"constant 20 heart  0.25 0.75  0  -110  123 99\n"
+	"constant 20 rect   0.75 0.75 -40 -150  80 300 25\n";
+
+PatternLibrary::PatternLibrary()
+{
+	loadFromString(DEFAULT_PATTERNS);
+}
+
+PatternLibrary::~PatternLibrary()
+{
+	clearPrototypes();
+}
+
+bool PatternLibrary::loadFromFile(const string& path)
+{
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		cout << "Pattern file " << path << " not found, using the built-in scene" << endl;
+		return false;
+	}
+	stringstream text;
+	text << file.rdbuf();
+	loadFromString(text.str());
+	return true;
+}
+
+// .:[Pattern Parsing]:.
+//          >> Blank lines and # comments are skipped; malformed lines are reported and skipped
+void PatternLibrary::loadFromString(const string& text)
+{
+	m_shapes.clear();
+	m_tables.clear();
+	clearPrototypes();
+
+	istringstream lines(text);
+	string line;
+	int lineNumber = 0;
+	while (getline(lines, line))
+	{
+		++lineNumber;
+		size_t comment = line.find('#');
+		if (comment != string::npos)
+		{
+			line.erase(comment);
+		}
+
+		istringstream fields(line);
+		string typeName;
+		if (!(fields >> typeName))
+		{
+			continue;
+		}
+
+		PatternShape shape;
+		if (typeName == "normal") { shape.type = NORMAL; }
+		else if (typeName == "constant") { shape.type = CONSTANT; }
+		else if (typeName == "wave") { shape.type = WAVE; }
+		else if (typeName == "grow") { shape.type = GROW; }
+		else
+		{
+			cout << "Error: Pattern line " << lineNumber << ": unknown particle type " << typeName << endl;
+			continue;
+		}
+
+		if (!(fields >> shape.numPoints >> shape.kind >> shape.fx >> shape.fy >> shape.dx >> shape.dy))
+		{
+			cout << "Error: Pattern line " << lineNumber << " is incomplete" << endl;
+			continue;
+		}
+		float param;
+		while (fields >> param)
+		{
+			shape.params.push_back(param);
+		}
+
+		size_t expected = (shape.kind == "rose" || shape.kind == "rect") ? 3 : 2;
+		bool known = shape.kind == "circle" || shape.kind == "rose" || shape.kind == "heart"
+			|| shape.kind == "hline" || shape.kind == "vline" || shape.kind == "rect";
+		if (!known || shape.params.size() != expected || shape.numPoints < 2 || shape.numPoints > MAX_POINTS
+			|| (shape.kind == "rect" && shape.params[2] < 2))
+		{
+			cout << "Error: Pattern line " << lineNumber << ": bad " << shape.kind << " shape" << endl;
+			continue;
+		}
+		m_shapes.push_back(shape);
+	}
+}
+
+const vector<SpawnPoint>& PatternLibrary::getSpawnTable(Vector2u windowSize)
+{
+	pair<unsigned, unsigned> key(windowSize.x, windowSize.y);
+	map<pair<unsigned, unsigned>, vector<SpawnPoint>>::iterator cached = m_tables.find(key);
+	if (cached != m_tables.end())
+	{
+		return cached->second;
+	}
+
+	vector<SpawnPoint>& table = m_tables[key];
+	for (const PatternShape& shape : m_shapes)
+	{
+		compile(shape, windowSize, table);
+	}
+	return table;
+}
+
+// .:[Prototype Particles]:.
+//          >> Built from the spawn table the same way the J handler used to build them every frame
+const vector<Particle*>& PatternLibrary::getPrototypes(RenderTarget& target)
+{
+	if (!m_prototypes.empty() && m_prototypeSize == target.getSize())
+	{
+		return m_prototypes;
+	}
+
+	clearPrototypes();
+	m_prototypeSize = target.getSize();
+	const vector<SpawnPoint>& table = getSpawnTable(m_prototypeSize);
+	m_prototypes.reserve(table.size());
+	for (const SpawnPoint& point : table)
+	{
+		Particle* prototype;
+		if (point.type == WAVE)
+		{
+			prototype = new WaveParticle(target, point.numPoints, point.position);
+		}
+		else if (point.type == CONSTANT)
+		{
+			prototype = new ConstantParticle(target, point.numPoints, point.position);
+		}
+		else if (point.type == GROW)
+		{
+			prototype = new GrowParticle(target, point.numPoints, point.position);
+		}
+		else
+		{
+			prototype = new Particle(target, point.numPoints, point.position);
+		}
+		prototype->setTTL(PATTERN_TTL);
+		m_prototypes.push_back(prototype);
+	}
+	return m_prototypes;
+}
+
+void PatternLibrary::clearPrototypes()
+{
+	for (Particle* prototype : m_prototypes)
+	{
+		delete prototype;
+	}
+	m_prototypes.clear();
+}
+
+// .:[Even Angles]:.
+//          >> count angles from 0 stepping 2 * PI / count, with their sines and cosines
+static void evenAngles(int count, vector<real>& angles, vector<real>& sines, vector<real>& cosines)
+{
+	angles.resize(count);
+	sines.resize(count);
+	cosines.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		angles[i] = i * (2 * M_PI / count);
+	}
+	sinCosBatch(angles.data(), sines.data(), cosines.data(), count);
+}
+
+// .:[Shape Compilation]:.
+//          >> The parametric equations from the original J handler
+void PatternLibrary::compile(const PatternShape& shape, Vector2u windowSize, vector<SpawnPoint>& table) const
+{
+	Vector2f anchor(shape.fx * windowSize.x + shape.dx, shape.fy * windowSize.y + shape.dy);
+	const vector<float>& p = shape.params;
+
+	// >> Adds one spawn point, truncating to whole pixels like the original code did
+	auto add = [&](float x, float y)
+	{
+		table.push_back({ Vector2i((int)x, (int)y), shape.type, shape.numPoints });
+	};
+
+	// >> Curves sample count evenly spaced angles; their sines and cosines come from one batch call
+	vector<real> angles, sines, cosines, petalSines, petalCosines;
+
+	if (shape.kind == "circle")
+	{
+		int count = (int)p[1];
+		evenAngles(count, angles, sines, cosines);
+		for (int i = 0; i < count; ++i)
+		{
+			add(anchor.x + p[0] * cosines[i], anchor.y + p[0] * sines[i]);
+		}
+	}
+	else if (shape.kind == "rose")
+	{
+		int petals = (int)p[1];
+		int count = (int)p[2];
+		evenAngles(count, angles, sines, cosines);
+		for (int i = 0; i < count; ++i)
+		{
+			angles[i] *= petals;
+		}
+		petalCosines.resize(count);
+		petalSines.resize(count);
+		sinCosBatch(angles.data(), petalSines.data(), petalCosines.data(), count);
+		for (int i = 0; i < count; ++i)
+		{
+			float r = p[0] * petalCosines[i];            // rose equation
+			add(anchor.x + r * cosines[i], anchor.y + r * sines[i]);
+		}
+	}
+	else if (shape.kind == "heart")
+	{
+		int count = (int)p[1];
+		evenAngles(count, angles, sines, cosines);
+		for (int i = 0; i < count; ++i)
+		{
+			float r = p[0] * (1 - sines[i]);              // polar heart equation
+			add(anchor.x + r * cosines[i], anchor.y + r * sines[i]);
+		}
+	}
+	else if (shape.kind == "hline" || shape.kind == "vline")
+	{
+		bool horizontal = (shape.kind == "hline");
+		int count = (int)p[0];
+		float spacing = (horizontal ? windowSize.x : windowSize.y) / (float)(count + 1);
+		for (int i = 1; i <= count; ++i)
+		{
+			float x = horizontal ? i * spacing : anchor.x;
+			float y = horizontal ? anchor.y : i * spacing;
+			float dx = x - anchor.x;
+			float dy = y - anchor.y;
+			if (sqrt(dx * dx + dy * dy) >= p[1])
+			{
+				add(x, y);
+			}
+		}
+	}
+	else if (shape.kind == "rect")
+	{
+		float width = p[0];
+		float height = p[1];
+		int count = (int)p[2];
+
+		// Left and right sides
+		for (int i = 0; i < count; ++i)
+		{
+			float t = i / (float)(count - 1);
+			add(anchor.x, anchor.y + t * height);
+			add(anchor.x + width, anchor.y + t * height);
+		}
+		// Top and bottom
+		for (int i = 0; i < count; ++i)
+		{
+			float t = i / (float)(count - 1);
+			add(anchor.x + t * width, anchor.y);
+			add(anchor.x + t * width, anchor.y + height);
+		}
+	}
+}
+
+// .:[Shape Outlines]:.
+//          >> Same curves as compile(), sampled densely and closed. The axes are left out; as walls they would
+//          >> cut the window into four boxes
+void PatternLibrary::getOutlines(Vector2u windowSize, vector<vector<Vector2f>>& outlines) const
+{
+	vector<real> angles, sines, cosines, petalSines, petalCosines;
+	for (const PatternShape& shape : m_shapes)
+	{
+		Vector2f anchor(shape.fx * windowSize.x + shape.dx, shape.fy * windowSize.y + shape.dy);
+		const vector<float>& p = shape.params;
+		vector<Vector2f> outline;
+
+		if (shape.kind == "circle" || shape.kind == "rose" || shape.kind == "heart")
+		{
+			evenAngles(OUTLINE_SAMPLES, angles, sines, cosines);
+			if (shape.kind == "rose")
+			{
+				for (real& angle : angles)
+				{
+					angle *= (int)p[1];
+				}
+				petalSines.resize(OUTLINE_SAMPLES);
+				petalCosines.resize(OUTLINE_SAMPLES);
+				sinCosBatch(angles.data(), petalSines.data(), petalCosines.data(), OUTLINE_SAMPLES);
+			}
+			for (int i = 0; i <= OUTLINE_SAMPLES; ++i)
+			{
+				int j = i % OUTLINE_SAMPLES;
+				float r = p[0];
+				if (shape.kind == "rose")
+				{
+					r = p[0] * petalCosines[j];
+				}
+				else if (shape.kind == "heart")
+				{
+					r = p[0] * (1 - sines[j]);
+				}
+				outline.push_back(Vector2f(anchor.x + r * cosines[j], anchor.y + r * sines[j]));
+			}
+		}
+		else if (shape.kind == "rect")
+		{
+			outline.push_back(anchor);
+			outline.push_back(Vector2f(anchor.x + p[0], anchor.y));
+			outline.push_back(Vector2f(anchor.x + p[0], anchor.y + p[1]));
+			outline.push_back(Vector2f(anchor.x, anchor.y + p[1]));
+			outline.push_back(anchor);
+		}
+		else
+		{
+			continue;
+		}
+		outlines.push_back(outline);
+	}
+}
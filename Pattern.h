@@ -0,0 +1,65 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "Particle.h"
+
+using namespace sf;
+using namespace std;
+
+const float PATTERN_TTL = 0.001f;       // Pattern particles only live for the frame they're drawn in
+
+// .:[Pattern Shape]:.
+//          >> One line of a pattern file; see patterns.txt for the format
+struct PatternShape
+{
+    ParticleType type;
+    int numPoints;
+    string kind;                        // circle, rose, heart, hline, vline or rect
+    float fx, fy;                       // Anchor as a fraction of the window size...
+    float dx, dy;                       // ...plus a pixel offset
+    vector<float> params;
+};
+
+struct SpawnPoint
+{
+    Vector2i position;
+    ParticleType type;
+    int numPoints;
+};
+
+// .:[Pattern Library]:.
+//          >> Parametric shapes for the J scene, compiled once per window size into a spawn table and a set of
+//          >> ready-built prototype particles. Spawning the scene is then just cloning the prototypes:
+//          >> no trig, no random numbers, no per-shape logic.
+class PatternLibrary
+{
+public:
+    PatternLibrary();
+    ~PatternLibrary();
+
+    ///Replace the shapes with the ones in a pattern file; the built-in scene stays if the file can't be read
+    bool loadFromFile(const string& path);
+    void loadFromString(const string& text);
+
+    ///Spawn positions for a window size, compiled on first use
+    const vector<SpawnPoint>& getSpawnTable(Vector2u windowSize);
+
+    ///Particles to clone for the pattern on this target; rebuilt only when the target's size changes
+    const vector<Particle*>& getPrototypes(RenderTarget& target);
+
+    ///Drop the cached prototypes; the next getPrototypes() builds them again, drawing from rand() as at startup
+    void clearPrototypes();
+
+    ///The closed shapes (circle, rose, heart, rect) as finely sampled pixel polylines, for collision
+    void getOutlines(Vector2u windowSize, vector<vector<Vector2f>>& outlines) const;
+
+private:
+    vector<PatternShape> m_shapes;
+    map<pair<unsigned, unsigned>, vector<SpawnPoint>> m_tables;
+    vector<Particle*> m_prototypes;
+    Vector2u m_prototypeSize;
+
+    void compile(const PatternShape& shape, Vector2u windowSize, vector<SpawnPoint>& table) const;
+};
@@ -0,0 +1,140 @@
+#include "QualityController.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+const float FRAME_TIME_SMOOTHING = 0.1f;    // Weight of the newest frame in the running average
+const float OVER_BUDGET = 1.05f;            // Average above target * this counts against the budget...
+const float UNDER_BUDGET = 0.75f;           // ...and below target * this counts as headroom
+const int FRAMES_TO_DEGRADE = 10;
+const int FRAMES_TO_RECOVER = 60;
+const float CULL_FRACTION = 0.02f;          // Share of live particles culled per frame in QUALITY_CULLING
+
+QualityController::QualityController(size_t maxParticles, float targetFrameTime)
+{
+	m_maxParticles = maxParticles;
+	m_targetFrameTime = targetFrameTime;
+}
+
+void QualityController::setAdaptive(bool adaptive)
+{
+	m_adaptive = adaptive;
+	m_requestPending = false;
+	m_awaitingStage = false;
+	if (!adaptive)
+	{
+		setStage(QUALITY_FULL);
+	}
+}
+
+// .:[Budget Tracking]:.
+void QualityController::endFrame(float workSeconds)
+{
+	m_averageFrameTime += (workSeconds - m_averageFrameTime) * FRAME_TIME_SMOOTHING;
+	if (!m_adaptive || m_awaitingStage)
+	{
+		return;
+	}
+
+	if (m_averageFrameTime > m_targetFrameTime * OVER_BUDGET)
+	{
+		m_underBudgetFrames = 0;
+		if (++m_overBudgetFrames >= FRAMES_TO_DEGRADE && m_stage < QUALITY_CULLING)
+		{
+			requestStage((QualityStage)(m_stage + 1));
+		}
+	}
+	else if (m_averageFrameTime < m_targetFrameTime * UNDER_BUDGET)
+	{
+		m_overBudgetFrames = 0;
+		if (++m_underBudgetFrames >= FRAMES_TO_RECOVER && m_stage > QUALITY_FULL)
+		{
+			requestStage((QualityStage)(m_stage - 1));
+		}
+	}
+	else
+	{
+		m_overBudgetFrames = 0;
+		m_underBudgetFrames = 0;
+	}
+}
+
+void QualityController::requestStage(QualityStage stage)
+{
+	m_requestedStage = stage;
+	m_requestPending = true;
+	m_awaitingStage = true;
+}
+
+bool QualityController::takeStageRequest(QualityStage& stage)
+{
+	if (!m_requestPending)
+	{
+		return false;
+	}
+	stage = m_requestedStage;
+	m_requestPending = false;
+	return true;
+}
+
+void QualityController::cancelStageRequest()
+{
+	m_requestPending = false;
+	m_awaitingStage = false;
+}
+
+int QualityController::pickPointCount() const
+{
+	if (m_stage >= QUALITY_REDUCED_POINTS)
+	{
+		return (rand() % 13) + 12;
+	}
+	return (rand() % 26) + 25;
+}
+
+int QualityController::admit(int requested, size_t liveParticles)
+{
+	if (requested <= 0)
+	{
+		return 0;
+	}
+
+	int admitted = requested;
+	if (m_stage >= QUALITY_THROTTLED)
+	{
+		float scale = (m_stage == QUALITY_CULLING) ? 0.25f : 0.5f;
+		m_admitAccumulator += requested * scale;
+		admitted = (int)m_admitAccumulator;
+		m_admitAccumulator -= admitted;
+	}
+
+	size_t room = (liveParticles < m_maxParticles) ? m_maxParticles - liveParticles : 0;
+	return (int)min((size_t)admitted, room);
+}
+
+size_t QualityController::getCullCount(size_t liveParticles) const
+{
+	size_t count = (liveParticles > m_maxParticles) ? liveParticles - m_maxParticles : 0;
+	if (m_stage == QUALITY_CULLING && liveParticles > 0)
+	{
+		count = max(count, max((size_t)1, (size_t)(liveParticles * CULL_FRACTION)));
+	}
+	return count;
+}
+
+void QualityController::setStage(QualityStage stage)
+{
+	m_awaitingStage = false;
+	if (stage == m_stage)
+	{
+		return;
+	}
+	const char* names[] = { "full", "reduced points", "emission throttled", "culling" };
+	cout << "Quality: " << names[stage] << " (average frame " << m_averageFrameTime * 1000.0f << " ms)" << endl;
+	m_stage = stage;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+	m_admitAccumulator = 0.0f;
+}
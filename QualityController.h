@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+
+// .:[Quality Stages]:.
+//          >> Each stage keeps the cuts of the ones before it
+enum QualityStage
+{
+    QUALITY_FULL,                       // 25-50 point fans, full emission
+    QUALITY_REDUCED_POINTS,             // 12-24 point fans for new particles
+    QUALITY_THROTTLED,                  // Emission cut to half
+    QUALITY_CULLING                     // Emission cut to a quarter, particles closest to expiring culled every frame
+};
+
+// .:[Quality Controller]:.
+//          >> Enforces a hard cap on live particles and steps quality down when update + draw run over the
+//          >> frame-time target, then back up once load drops. Stepping down reacts within a few frames;
+//          >> stepping up waits for a full second of headroom so the stages don't oscillate.
+//          >> endFrame() only requests a stage; the engine applies it through the input queue with setStage(), so
+//          >> the change lands on a step boundary and is logged in a recorded session like any other input.
+class QualityController
+{
+public:
+    QualityController(size_t maxParticles = 50000, float targetFrameTime = 1.0f / 60.0f);
+
+    void setMaxParticles(size_t maxParticles) { m_maxParticles = maxParticles; }
+    void setTargetFrameTime(float seconds) { m_targetFrameTime = seconds; }
+
+    ///With adaptation off only the hard cap applies; used where results must not depend on timing (replay, offline)
+    void setAdaptive(bool adaptive);
+
+    ///Report how long the last step's update and draw took; the slower of the two when they ran on separate threads
+    void endFrame(float workSeconds);
+
+    ///Hands over a stage endFrame() asked for, once; no new request is made until it has been applied
+    bool takeStageRequest(QualityStage& stage);
+
+    ///Forget a taken request that could not be delivered; endFrame() asks again on the next frame
+    void cancelStageRequest();
+
+    ///Switch stages now; for requested stages at a step boundary, and stages replayed from a session log
+    void setStage(QualityStage stage);
+
+    ///Fan point count for a new particle; draws one rand() like the spawn code always has
+    int pickPointCount() const;
+
+    ///How many of the requested spawns may go ahead under the cap and the current emission scale
+    int admit(int requested, size_t liveParticles);
+
+    ///How many live particles should be culled this frame
+    size_t getCullCount(size_t liveParticles) const;
+
+    QualityStage getStage() const { return m_stage; }
+    size_t getMaxParticles() const { return m_maxParticles; }
+    float getAverageFrameTime() const { return m_averageFrameTime; }
+
+private:
+    size_t m_maxParticles;
+    float m_targetFrameTime;
+    bool m_adaptive = true;
+    QualityStage m_stage = QUALITY_FULL;
+    float m_averageFrameTime = 0.0f;
+    int m_overBudgetFrames = 0;
+    int m_underBudgetFrames = 0;
+    float m_admitAccumulator = 0.0f;    // Fractional spawns carried over while throttled
+    QualityStage m_requestedStage = QUALITY_FULL;
+    bool m_requestPending = false;      // Requested and not yet taken
+    bool m_awaitingStage = false;       // Requested and not yet applied
+
+    void requestStage(QualityStage stage);
+};
@@ -0,0 +1,221 @@
+#include "Session.h"
+#include <cstring>
+#include <iostream>
+
+///////////////////////////////////////////////
+// Session Recorder
+///////////////////////////////////////////////
+
+SessionRecorder::~SessionRecorder()
+{
+	close();
+}
+
+// .:[Open Log]:.
+//          >> Truncates the file and writes the header
+bool SessionRecorder::open(const string& path, uint32_t seed, Vector2u windowSize, const SessionOptions& options)
+{
+	m_file.open(path, ios::binary | ios::trunc);
+	if (!m_file.is_open())
+	{
+		cout << "Error: Session log " << path << " cannot be opened for writing" << endl;
+		return false;
+	}
+
+	m_file.write("PSES", 4);
+	writeU16(SESSION_VERSION);
+	writeU32(seed);
+	writeU16((uint16_t)windowSize.x);
+	writeU16((uint16_t)windowSize.y);
+	writeByte(options.compactParticles ? 1 : 0);
+	writeU32(options.maxParticles);
+	m_framesSinceFlush = 0;
+	return true;
+}
+
+void SessionRecorder::close()
+{
+	if (m_file.is_open())
+	{
+		m_file.flush();
+		m_file.close();
+	}
+}
+
+void SessionRecorder::recordFrame(float dt)
+{
+	if (!isOpen())
+	{
+		return;
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &dt, sizeof(bits));			// Stored bit-exact so replayed physics match
+	writeByte(SESSION_FRAME);
+	writeU32(bits);
+
+	// Flush about once a second so a crashed session still leaves a usable log
+	if (++m_framesSinceFlush >= 60)
+	{
+		m_file.flush();
+		m_framesSinceFlush = 0;
+	}
+}
+
+void SessionRecorder::recordEvent(const SessionEvent& event)
+{
+	if (!isOpen())
+	{
+		return;
+	}
+	writeByte(event.tag);
+	if (sessionTagHasPosition(event.tag))
+	{
+		writeU16((uint16_t)(int16_t)event.position.x);
+		writeU16((uint16_t)(int16_t)event.position.y);
+	}
+	else if (sessionTagHasValue(event.tag))
+	{
+		writeByte(event.value);
+	}
+}
+
+void SessionRecorder::writeByte(uint8_t value)
+{
+	m_file.put((char)value);
+}
+
+void SessionRecorder::writeU16(uint16_t value)
+{
+	writeByte(value & 0xFF);
+	writeByte(value >> 8);
+}
+
+void SessionRecorder::writeU32(uint32_t value)
+{
+	writeU16(value & 0xFFFF);
+	writeU16(value >> 16);
+}
+
+///////////////////////////////////////////////
+// Session Player
+///////////////////////////////////////////////
+
+// .:[Open Log]:.
+//          >> Loads the file and validates the header
+bool SessionPlayer::open(const string& path)
+{
+	close();
+
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+	{
+		cout << "Error: Session log " << path << " cannot be opened" << endl;
+		return false;
+	}
+	m_data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+	if (m_data.size() < 14 || memcmp(m_data.data(), "PSES", 4) != 0)
+	{
+		cout << "Error: " << path << " is not a session log" << endl;
+		m_data.clear();
+		return false;
+	}
+	m_cursor = 4;
+	uint16_t version = readU16();
+	if (version < SESSION_MIN_VERSION || version > SESSION_VERSION)
+	{
+		cout << "Error: Session log version " << version << " is not supported (" << SESSION_MIN_VERSION << " to "
+			<< SESSION_VERSION << " replay)" << endl;
+		m_data.clear();
+		return false;
+	}
+	m_version = version;
+	m_seed = readU32();
+	m_windowSize.x = readU16();
+	m_windowSize.y = readU16();
+	m_options = SessionOptions();
+	if (version >= SESSION_OPTIONS_VERSION)
+	{
+		if (!canRead(5))
+		{
+			cout << "Error: Session log " << path << " ends inside its header" << endl;
+			m_data.clear();
+			return false;
+		}
+		m_options.compactParticles = (m_data[m_cursor++] & 1) != 0;
+		m_options.maxParticles = readU32();
+	}
+	m_frame = 0;
+	m_open = true;
+	return true;
+}
+
+bool SessionPlayer::nextFrame(float& dt)
+{
+	// Skip anything left over from the previous frame
+	SessionEvent skipped;
+	while (nextEvent(skipped)) {}
+
+	if (!canRead(5) || m_data[m_cursor] != SESSION_FRAME)
+	{
+		return false;
+	}
+	++m_cursor;
+	uint32_t bits = readU32();
+	memcpy(&dt, &bits, sizeof(dt));
+	++m_frame;
+	return true;
+}
+
+bool SessionPlayer::nextEvent(SessionEvent& event)
+{
+	if (!canRead(1) || m_data[m_cursor] == SESSION_FRAME)
+	{
+		return false;
+	}
+
+	event.tag = (SessionTag)m_data[m_cursor++];
+	if (sessionTagHasPosition(event.tag))
+	{
+		if (!canRead(4))
+		{
+			m_cursor = m_data.size();				// Truncated record at the end of a crashed session
+			return false;
+		}
+		event.position.x = (int16_t)readU16();
+		event.position.y = (int16_t)readU16();
+	}
+	else if (sessionTagHasValue(event.tag))
+	{
+		if (!canRead(1))
+		{
+			m_cursor = m_data.size();
+			return false;
+		}
+		event.value = m_data[m_cursor++];
+	}
+	else if (event.tag != SESSION_RIGHT_CLICK && event.tag != SESSION_PATTERN && event.tag != SESSION_BREEZE
+		&& event.tag != SESSION_COLLIDE && event.tag != SESSION_SMOKE && event.tag != SESSION_DUST
+		&& event.tag != SESSION_SAVE && event.tag != SESSION_LOAD)
+	{
+		cout << "Error: Unknown session record " << (int)event.tag << " at byte " << m_cursor - 1 << endl;
+		m_cursor = m_data.size();
+		return false;
+	}
+	return true;
+}
+
+uint16_t SessionPlayer::readU16()
+{
+	uint16_t value = m_data[m_cursor] | (m_data[m_cursor + 1] << 8);
+	m_cursor += 2;
+	return value;
+}
+
+uint32_t SessionPlayer::readU32()
+{
+	uint32_t low = readU16();
+	uint32_t high = readU16();
+	return low | (high << 16);
+}
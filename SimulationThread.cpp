@@ -0,0 +1,78 @@
+#include "SimulationThread.h"
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+void SimulationThread::start(const function<void(float dt)>& step)
+{
+	if (isRunning())
+	{
+		return;
+	}
+	m_step = step;
+	m_stopping = false;
+	m_thread = thread(&SimulationThread::loop, this);
+}
+
+void SimulationThread::stop()
+{
+	if (!isRunning())
+	{
+		return;
+	}
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+void SimulationThread::kick(float dt)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_dt = dt;
+		m_kicked = true;
+		m_busy.store(true, memory_order_relaxed);
+	}
+	m_wake.notify_one();
+}
+
+void SimulationThread::wait()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return !m_busy.load(memory_order_relaxed); });
+}
+
+// .:[Step Loop]:.
+//          >> A step that was kicked before stop() still runs, so the last input handed over is never lost
+void SimulationThread::loop()
+{
+	while (true)
+	{
+		float dt;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_kicked || m_stopping; });
+			if (!m_kicked)
+			{
+				return;
+			}
+			dt = m_dt;
+			m_kicked = false;
+		}
+
+		Clock stepClock;
+		m_step(dt);
+		m_stepTime = stepClock.getElapsedTime().asSeconds();
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_busy.store(false, memory_order_release);
+		}
+		m_done.notify_all();
+	}
+}
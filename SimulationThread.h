@@ -0,0 +1,61 @@
+#pragma once
+#include <SFML/System.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace sf;
+using namespace std;
+
+// .:[Simulation Thread]:.
+//          >> Runs one simulation step at a time on its own thread, so spawning and physics never hold up a
+//          >> frame on the main thread. The main thread kick()s a step, keeps presenting the last frame it
+//          >> prepared, and checks isDone() once per frame; it only reads simulation state, or hands the
+//          >> thread the next step, once that is true. Only one step is ever in flight, so the simulation
+//          >> and the code reading it between steps never run at the same time and need no other locking.
+//          >> The acquire in isDone() pairs with the release that ends a step, so everything the step wrote
+//          >> is visible to the main thread from then on.
+class SimulationThread
+{
+public:
+    SimulationThread() = default;
+    ~SimulationThread();
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    ///Start the thread; step(dt) runs on it once for every kick()
+    void start(const function<void(float dt)>& step);
+
+    ///Finish the step in flight, if there is one, then join the thread
+    void stop();
+
+    bool isRunning() const { return m_thread.joinable(); }
+
+    ///Hand the thread one step of dt seconds. Only call while isDone()
+    void kick(float dt);
+
+    ///True once the last kicked step has finished, and until the next kick()
+    bool isDone() const { return !m_busy.load(memory_order_acquire); }
+
+    ///Block until the step in flight has finished
+    void wait();
+
+    ///Seconds the last finished step took
+    float getStepTime() const { return m_stepTime; }
+
+private:
+    thread m_thread;
+    mutex m_mutex;
+    condition_variable m_wake;
+    condition_variable m_done;
+    function<void(float)> m_step;
+    float m_dt = 0.0f;
+    bool m_kicked = false;
+    bool m_stopping = false;
+    atomic<bool> m_busy{ false };
+    float m_stepTime = 0.0f;                // Written by the thread before it releases m_busy
+
+    void loop();
+};
@@ -0,0 +1,251 @@
+#include "SmokeField.h"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const int JACOBI_ITERATIONS = 30;
+const int ROW_GRAIN = 8;                    // Rows per job
+const float SMOKE_DEPOSIT = 1.5f;           // Density a particle adds to its cell per second
+const float SMOKE_PUSH = 4.0f;              // Per second; how fast a particle's cell takes on its velocity
+const float SMOKE_DRAG = 0.8f;              // Per second; how fast a particle takes on the air's velocity
+const float SMOKE_DISSIPATION = 0.35f;      // Share of density lost per second
+const Uint8 SMOKE_SHADE[3] = { 170, 175, 200 };
+
+SmokeField::SmokeField(ThreadPool& threadPool, int columns, int rows)
+	: m_threadPool(threadPool), m_columns(max(columns, 3)), m_rows(max(rows, 3))
+{
+	size_t cells = (size_t)m_columns * m_rows;
+	for (vector<float>* field : { &m_u, &m_v, &m_density, &m_u0, &m_v0, &m_density0, &m_pressure, &m_pressure0, &m_divergence })
+	{
+		field->assign(cells, 0.0f);
+	}
+	m_pixels.assign(cells * 4, 0);
+}
+
+void SmokeField::clear()
+{
+	for (vector<float>* field : { &m_u, &m_v, &m_density, &m_pressure })
+	{
+		fill(field->begin(), field->end(), 0.0f);
+	}
+}
+
+// .:[Particle Coupling]:.
+//          >> Serial, since particles scatter into arbitrary cells; the push is a relaxation, so crowded cells
+//          >> settle on an average velocity instead of adding up
+void SmokeField::couple(const vector<Particle*>& particles, Vector2u windowSize, float dt)
+{
+	float cellWidth = (float)windowSize.x / m_columns;
+	float cellHeight = (float)windowSize.y / m_rows;
+	float push = min(1.0f, SMOKE_PUSH * dt);
+	for (Particle* particle : particles)
+	{
+		Vector2f center = particle->getCenter();
+		float gx = (center.x + windowSize.x * 0.5f) / cellWidth;
+		float gy = (windowSize.y * 0.5f - center.y) / cellHeight;
+		if (gx < 1.0f || gy < 1.0f || gx >= m_columns - 1 || gy >= m_rows - 1)
+		{
+			continue;
+		}
+
+		Vector2f velocity = particle->getVelocity();
+		float cellU = velocity.x / cellWidth;
+		float cellV = -velocity.y / cellHeight;
+		float airU = sampleBilinear(m_u, gx - 0.5f, gy - 0.5f);
+		float airV = sampleBilinear(m_v, gx - 0.5f, gy - 0.5f);
+		particle->accelerate((airU - cellU) * cellWidth * SMOKE_DRAG, -(airV - cellV) * cellHeight * SMOKE_DRAG, dt);
+
+		size_t cell = index((int)gx, (int)gy);
+		m_density[cell] += SMOKE_DEPOSIT * dt;
+		m_u[cell] += (cellU - m_u[cell]) * push;
+		m_v[cell] += (cellV - m_v[cell]) * push;
+	}
+}
+
+// .:[Fluid Step]:.
+void SmokeField::step(float dt)
+{
+	m_u0.swap(m_u);
+	m_v0.swap(m_v);
+	forRows([&](int y)
+	{
+		for (int x = 1; x < m_columns - 1; x++)
+		{
+			size_t i = index(x, y);
+			float sx = x - dt * m_u0[i];
+			float sy = y - dt * m_v0[i];
+			m_u[i] = sampleBilinear(m_u0, sx, sy);
+			m_v[i] = sampleBilinear(m_v0, sx, sy);
+		}
+	});
+	setWalls();
+	project();
+
+	m_density0.swap(m_density);
+	advect(m_density0, m_density, dt);
+	float keep = max(0.0f, 1.0f - SMOKE_DISSIPATION * dt);
+	forRows([&](int y)
+	{
+		float* row = &m_density[index(0, y)];
+		for (int x = 0; x < m_columns; x++)
+		{
+			row[x] *= keep;
+		}
+	});
+}
+
+// .:[Draw]:.
+//          >> Density becomes alpha over a fixed shade; the texture is smoothed so cells blend into each other
+void SmokeField::prepare()
+{
+	forRows([&](int y)
+	{
+		const float* density = &m_density[index(0, y)];
+		Uint8* pixel = &m_pixels[index(0, y) * 4];
+		for (int x = 0; x < m_columns; x++, pixel += 4)
+		{
+			pixel[0] = SMOKE_SHADE[0];
+			pixel[1] = SMOKE_SHADE[1];
+			pixel[2] = SMOKE_SHADE[2];
+			pixel[3] = (Uint8)(min(density[x], 1.0f) * 255.0f);
+		}
+	});
+
+	if (m_texture.getSize() != Vector2u(m_columns, m_rows))
+	{
+		m_texture.create(m_columns, m_rows);
+		m_texture.setSmooth(true);
+	}
+	m_texture.update(m_pixels.data());
+}
+
+void SmokeField::draw(RenderTarget& target) const
+{
+	Sprite sprite(m_texture);
+	sprite.setScale((float)target.getSize().x / m_columns, (float)target.getSize().y / m_rows);
+	target.draw(sprite);
+}
+
+float SmokeField::sampleBilinear(const vector<float>& field, float x, float y) const
+{
+	x = max(0.5f, min(x, m_columns - 1.5f));
+	y = max(0.5f, min(y, m_rows - 1.5f));
+	int x0 = (int)x;
+	int y0 = (int)y;
+	float fx = x - x0;
+	float fy = y - y0;
+	const float* top = &field[index(x0, y0)];
+	const float* bottom = top + m_columns;
+	float upper = top[0] + (top[1] - top[0]) * fx;
+	float lower = bottom[0] + (bottom[1] - bottom[0]) * fx;
+	return upper + (lower - upper) * fy;
+}
+
+// .:[Row Passes]:.
+//          >> Interior rows only; the walls are handled by setWalls()
+void SmokeField::forRows(const function<void(int row)>& pass)
+{
+	m_threadPool.parallelFor(m_rows - 2, [&](int begin, int end)
+	{
+		for (int row = begin; row < end; row++)
+		{
+			pass(row + 1);
+		}
+	}, ROW_GRAIN);
+}
+
+void SmokeField::advect(const vector<float>& source, vector<float>& destination, float dt)
+{
+	forRows([&](int y)
+	{
+		for (int x = 1; x < m_columns - 1; x++)
+		{
+			size_t i = index(x, y);
+			destination[i] = sampleBilinear(source, x - dt * m_u[i], y - dt * m_v[i]);
+		}
+	});
+}
+
+// .:[Jacobi Row]:.
+//          >> out = (left + right + up + down - divergence) / 4 for count cells starting at p
+static void jacobiRow(const float* p, const float* divergence, float* out, int count, int stride)
+{
+	int i = 0;
+#ifdef __SSE2__
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sum = _mm_add_ps(_mm_loadu_ps(p + i - 1), _mm_loadu_ps(p + i + 1));
+		sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(p + i - stride), _mm_loadu_ps(p + i + stride)));
+		sum = _mm_sub_ps(sum, _mm_loadu_ps(divergence + i));
+		_mm_storeu_ps(out + i, _mm_mul_ps(sum, quarter));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		out[i] = (p[i - 1] + p[i + 1] + p[i - stride] + p[i + stride] - divergence[i]) * 0.25f;
+	}
+}
+
+// .:[Projection]:.
+//          >> Solves for the pressure whose gradient removes the velocity's divergence, then subtracts it.
+//          >> Pressure is Neumann at the walls (copied from the neighbour), which keeps the solve well posed
+void SmokeField::project()
+{
+	const int stride = m_columns;
+	const int width = m_columns - 2;
+	forRows([&](int y)
+	{
+		for (int x = 1; x < m_columns - 1; x++)
+		{
+			size_t i = index(x, y);
+			m_divergence[i] = 0.5f * (m_u[i + 1] - m_u[i - 1] + m_v[i + stride] - m_v[i - stride]);
+		}
+	});
+
+	for (int iteration = 0; iteration < JACOBI_ITERATIONS; iteration++)
+	{
+		m_pressure0.swap(m_pressure);
+		forRows([&](int y)
+		{
+			size_t i = index(1, y);
+			jacobiRow(&m_pressure0[i], &m_divergence[i], &m_pressure[i], width, stride);
+		});
+		for (int y = 1; y < m_rows - 1; y++)
+		{
+			m_pressure[index(0, y)] = m_pressure[index(1, y)];
+			m_pressure[index(m_columns - 1, y)] = m_pressure[index(m_columns - 2, y)];
+		}
+		copy(&m_pressure[index(0, 1)], &m_pressure[index(0, 2)], &m_pressure[index(0, 0)]);
+		copy(&m_pressure[index(0, m_rows - 2)], &m_pressure[index(0, m_rows - 1)], &m_pressure[index(0, m_rows - 1)]);
+	}
+
+	forRows([&](int y)
+	{
+		for (int x = 1; x < m_columns - 1; x++)
+		{
+			size_t i = index(x, y);
+			m_u[i] -= 0.5f * (m_pressure[i + 1] - m_pressure[i - 1]);
+			m_v[i] -= 0.5f * (m_pressure[i + stride] - m_pressure[i - stride]);
+		}
+	});
+	setWalls();
+}
+
+// .:[Walls]:.
+//          >> No flow through or along the outer ring
+void SmokeField::setWalls()
+{
+	for (int x = 0; x < m_columns; x++)
+	{
+		m_u[index(x, 0)] = m_v[index(x, 0)] = 0.0f;
+		m_u[index(x, m_rows - 1)] = m_v[index(x, m_rows - 1)] = 0.0f;
+	}
+	for (int y = 0; y < m_rows; y++)
+	{
+		m_u[index(0, y)] = m_v[index(0, y)] = 0.0f;
+		m_u[index(m_columns - 1, y)] = m_v[index(m_columns - 1, y)] = 0.0f;
+	}
+}
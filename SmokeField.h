@@ -0,0 +1,55 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Particle.h"
+#include "ThreadPool.h"
+
+using namespace sf;
+using namespace std;
+
+// .:[Smoke Field]:.
+//          >> Eulerian density and velocity on a fixed grid stretched over the window. Every step particles
+//          >> deposit smoke and drag the air along with them, the air drags the particles back, and then the grid
+//          >> runs stable fluids: semi-Lagrangian advection of velocity, a Jacobi pressure solve that makes the
+//          >> velocity divergence-free, then advection of density.
+//          >> Every pass is a row loop split across the thread pool, reading one array and writing another, so
+//          >> rows never race; the Jacobi sweep, which is most of the work, runs four cells at a time with SSE2.
+//          >> All arrays are allocated once in the constructor; the grid never changes size.
+//          >> Velocities are in cells per second, y down like pixels. The outer ring of cells is the wall.
+class SmokeField
+{
+public:
+    SmokeField(ThreadPool& threadPool, int columns, int rows);
+
+    ///Particles deposit density and push the air, and the air pushes back; windowSize maps particles onto the grid
+    void couple(const vector<Particle*>& particles, Vector2u windowSize, float dt);
+
+    ///Advance the fluid by dt
+    void step(float dt);
+
+    ///Shade the density into the texture; call between steps, since it reads the grid
+    void prepare();
+
+    ///Stretch the texture from the last prepare() over the whole target as one sprite
+    void draw(RenderTarget& target) const;
+
+    void clear();
+
+private:
+    ThreadPool& m_threadPool;
+    int m_columns;
+    int m_rows;
+    vector<float> m_u, m_v, m_density;          // Current state
+    vector<float> m_u0, m_v0, m_density0;       // Advection sources, swapped with the current state each step
+    vector<float> m_pressure, m_pressure0;      // Kept between steps to warm start the solve
+    vector<float> m_divergence;
+    vector<Uint8> m_pixels;                     // RGBA8, one pixel per cell
+    Texture m_texture;
+
+    size_t index(int x, int y) const { return (size_t)y * m_columns + x; }
+    float sampleBilinear(const vector<float>& field, float x, float y) const;
+    void forRows(const function<void(int row)>& pass);
+    void advect(const vector<float>& source, vector<float>& destination, float dt);
+    void project();
+    void setWalls();
+};
@@ -0,0 +1,113 @@
+#include "Snapshot.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SnapshotFile::~SnapshotFile()
+{
+	close();
+}
+
+// .:[Write Snapshot]:.
+//          >> Fills in the bookkeeping fields of the header and dumps it and the states in one go
+bool SnapshotFile::write(const string& path, SnapshotHeader header, const vector<ParticleState>& states)
+{
+	memcpy(header.magic, "PSNP", 4);
+	header.version = SNAPSHOT_VERSION;
+	header.headerSize = sizeof(SnapshotHeader);
+	header.stateSize = sizeof(ParticleState);
+	header.particleCount = states.size();
+
+	ofstream file(path, ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "Error: Snapshot " << path << " cannot be opened for writing" << endl;
+		return false;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)states.data(), states.size() * sizeof(ParticleState));
+	return file.good();
+}
+
+// .:[Open Snapshot]:.
+//          >> Maps the file and validates the header; nothing is copied or parsed
+bool SnapshotFile::open(const string& path)
+{
+	close();
+
+#ifdef _WIN32
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+	{
+		cout << "Error: Snapshot " << path << " cannot be opened" << endl;
+		return false;
+	}
+	m_buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		cout << "Error: Snapshot " << path << " cannot be opened" << endl;
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		cout << "Error: Snapshot " << path << " is empty" << endl;
+		return false;
+	}
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);                                // The mapping keeps the file alive
+	if (mapping == MAP_FAILED)
+	{
+		cout << "Error: Snapshot " << path << " cannot be mapped" << endl;
+		return false;
+	}
+	m_data = (const char*)mapping;
+	m_size = info.st_size;
+#endif
+
+	if (m_size < sizeof(SnapshotHeader) || memcmp(getHeader().magic, "PSNP", 4) != 0)
+	{
+		cout << "Error: " << path << " is not a snapshot" << endl;
+		close();
+		return false;
+	}
+	const SnapshotHeader& header = getHeader();
+	if (header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader) || header.stateSize != sizeof(ParticleState))
+	{
+		cout << "Error: Snapshot " << path << " was written by an incompatible version" << endl;
+		close();
+		return false;
+	}
+	if (header.particleCount > (m_size - sizeof(SnapshotHeader)) / sizeof(ParticleState))       // Divides, so a huge count can't wrap
+	{
+		cout << "Error: Snapshot " << path << " is truncated" << endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void SnapshotFile::close()
+{
+#ifdef _WIN32
+	m_buffer.clear();
+#else
+	if (m_data != nullptr)
+	{
+		munmap((void*)m_data, m_size);
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Particle.h"
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// .:[Snapshot File Layout]:.
+//          >> SnapshotHeader followed directly by particleCount ParticleStates, no padding or compression.
+//          >> Both structs are plain data in native byte order, so a mapped file is used in place:
+//          >> getParticles() points straight into the mapping.
+const uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader
+{
+    char magic[4];                      // "PSNP"
+    uint32_t version;
+    uint32_t headerSize;                // sizeof(SnapshotHeader) and sizeof(ParticleState) when written;
+    uint32_t stateSize;                 // guards against layout changes between builds
+    uint64_t particleCount;
+    uint32_t rngSeed;                   // rand() is reseeded with this on save and on load
+    int32_t particleID;                 // Selected particle type in the UI
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+};
+
+static_assert(is_trivially_copyable<ParticleState>::value && is_standard_layout<ParticleState>::value, "ParticleState must stay plain data");
+static_assert(sizeof(SnapshotHeader) % alignof(ParticleState) == 0, "ParticleStates must stay aligned after the header");
+
+// .:[Snapshot File]:.
+//          >> Writes a snapshot, or maps one read-only
+class SnapshotFile
+{
+public:
+    SnapshotFile() {}
+    ~SnapshotFile();
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    static bool write(const string& path, SnapshotHeader header, const vector<ParticleState>& states);
+
+    bool open(const string& path);
+    void close();
+
+    const SnapshotHeader& getHeader() const { return *(const SnapshotHeader*)m_data; }
+    const ParticleState* getParticles() const { return (const ParticleState*)(m_data + sizeof(SnapshotHeader)); }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    vector<char> m_buffer;              // No mmap here; the file is read into memory instead
+#endif
+};
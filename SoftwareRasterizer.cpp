@@ -0,0 +1,213 @@
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// .:[Span Blending]:.
+//          >> Blends count pixels whose color runs from outer (lambda 0) to center (lambda 1), lambda stepping by
+//          >> dLambda per pixel. Colors are RGBA floats in 0-255. dst = src * srcAlpha + dst * (1 - srcAlpha) for RGB,
+//          >> dst = src + dst * (1 - srcAlpha) for alpha, matching BlendAlpha.
+static void blendSpan(Uint8* dst, int count, float lambda, float dLambda, const float* center, const float* outer)
+{
+#ifdef __SSE2__
+	// One pixel's four channels per SSE register
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+	const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+	const __m128i zeroI = _mm_setzero_si128();
+	const __m128 vOuter = _mm_loadu_ps(outer);
+	const __m128 vDiff = _mm_sub_ps(_mm_loadu_ps(center), vOuter);
+
+	for (int i = 0; i < count; i++, dst += 4, lambda += dLambda)
+	{
+		__m128 weight = _mm_min_ps(_mm_max_ps(_mm_set1_ps(lambda), zero), one);
+		__m128 src = _mm_add_ps(vOuter, _mm_mul_ps(vDiff, weight));
+		__m128 alpha = _mm_mul_ps(_mm_shuffle_ps(src, src, _MM_SHUFFLE(3, 3, 3, 3)), inv255);
+		__m128 srcFactor = _mm_or_ps(_mm_andnot_ps(alphaLane, alpha), _mm_and_ps(alphaLane, one));
+
+		int packed;
+		memcpy(&packed, dst, 4);
+		__m128i dst32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zeroI), zeroI);
+		__m128 blended = _mm_add_ps(_mm_mul_ps(src, srcFactor), _mm_mul_ps(_mm_cvtepi32_ps(dst32), _mm_sub_ps(one, alpha)));
+
+		__m128i out32 = _mm_cvtps_epi32(blended);
+		__m128i out16 = _mm_packs_epi32(out32, out32);
+		packed = _mm_cvtsi128_si32(_mm_packus_epi16(out16, out16));
+		memcpy(dst, &packed, 4);
+	}
+#else
+	for (int i = 0; i < count; i++, dst += 4, lambda += dLambda)
+	{
+		float weight = min(max(lambda, 0.0f), 1.0f);
+		float src[4];
+		for (int c = 0; c < 4; c++)
+		{
+			src[c] = outer[c] + (center[c] - outer[c]) * weight;
+		}
+		float alpha = src[3] / 255.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			dst[c] = (Uint8)min(255.0f, src[c] * alpha + dst[c] * (1.0f - alpha) + 0.5f);
+		}
+		dst[3] = (Uint8)min(255.0f, src[3] + dst[3] * (1.0f - alpha) + 0.5f);
+	}
+#endif
+}
+
+void SoftwareRasterizer::begin(Vector2u size, Color clearColor)
+{
+	if (size != m_size)
+	{
+		m_size = size;
+		m_pixels.assign(size.x * size.y * 4, 0);
+		m_tilesX = (size.x + TILE_SIZE - 1) / TILE_SIZE;
+		m_tilesY = (size.y + TILE_SIZE - 1) / TILE_SIZE;
+		m_bins.assign(m_tilesX * m_tilesY, vector<int>());
+	}
+	m_clearColor = clearColor;
+	m_triangles.clear();
+	for (vector<int>& bin : m_bins)
+	{
+		bin.clear();                            // Keeps capacity, so steady frames don't allocate
+	}
+}
+
+// .:[Fan Submission]:.
+//          >> Splits the fan into triangles and drops each into every tile its bounding box touches
+void SoftwareRasterizer::addFan(const Vector2f* points, int numPoints, Color centerColor, Color outerColor)
+{
+	for (int j = 1; j < numPoints; j++)
+	{
+		Triangle triangle = { points[0], points[j], points[j + 1], centerColor, outerColor };
+
+		float minX = min(triangle.center.x, min(triangle.a.x, triangle.b.x));
+		float maxX = max(triangle.center.x, max(triangle.a.x, triangle.b.x));
+		float minY = min(triangle.center.y, min(triangle.a.y, triangle.b.y));
+		float maxY = max(triangle.center.y, max(triangle.a.y, triangle.b.y));
+		int tileX0 = max(0, (int)floor(minX) / TILE_SIZE);
+		int tileX1 = min(m_tilesX - 1, (int)floor(maxX) / TILE_SIZE);
+		int tileY0 = max(0, (int)floor(minY) / TILE_SIZE);
+		int tileY1 = min(m_tilesY - 1, (int)floor(maxY) / TILE_SIZE);
+		if (maxX < 0 || maxY < 0 || tileX0 > tileX1 || tileY0 > tileY1)
+		{
+			continue;                           // Entirely off screen
+		}
+
+		int index = (int)m_triangles.size();
+		m_triangles.push_back(triangle);
+		for (int ty = tileY0; ty <= tileY1; ty++)
+		{
+			for (int tx = tileX0; tx <= tileX1; tx++)
+			{
+				m_bins[ty * m_tilesX + tx].push_back(index);
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::render()
+{
+	m_threadPool.parallelFor(m_tilesX * m_tilesY, [this](int begin, int end)
+	{
+		for (int tile = begin; tile < end; tile++)
+		{
+			renderTile(tile);
+		}
+	}, 1);
+}
+
+void SoftwareRasterizer::renderTile(int tile)
+{
+	int minX = (tile % m_tilesX) * TILE_SIZE;
+	int minY = (tile / m_tilesX) * TILE_SIZE;
+	int maxX = min(minX + TILE_SIZE, (int)m_size.x);
+	int maxY = min(minY + TILE_SIZE, (int)m_size.y);
+
+	// Clear this tile's part of the framebuffer
+	Uint8 clear[4] = { m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a };
+	for (int y = minY; y < maxY; y++)
+	{
+		Uint8* pixel = &m_pixels[(y * m_size.x + minX) * 4];
+		for (int x = minX; x < maxX; x++, pixel += 4)
+		{
+			memcpy(pixel, clear, 4);
+		}
+	}
+
+	for (int index : m_bins[tile])
+	{
+		fillTriangle(m_triangles[index], minX, minY, maxX, maxY);
+	}
+}
+
+// .:[Triangle Fill]:.
+//          >> Scanline fill clipped to one tile. Each edge function is normalized by the triangle's area so it equals
+//          >> the opposite vertex's barycentric weight; the edge facing the center gives the center color's weight.
+//          >> A pixel is covered when its center lies in [left edge, right edge), so neighbouring fan triangles
+//          >> never blend a shared pixel twice.
+void SoftwareRasterizer::fillTriangle(const Triangle& triangle, int minX, int minY, int maxX, int maxY)
+{
+	const Vector2f v[3] = { triangle.center, triangle.a, triangle.b };
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if (fabs(area) < 1e-6f)
+	{
+		return;
+	}
+
+	// Edge i is opposite vertex i: weight_i(x, y) = A[i] * x + B[i] * y + C[i]
+	float A[3], B[3], C[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const Vector2f& p = v[(i + 1) % 3];
+		const Vector2f& q = v[(i + 2) % 3];
+		A[i] = -(q.y - p.y) / area;
+		B[i] = (q.x - p.x) / area;
+		C[i] = ((q.y - p.y) * p.x - (q.x - p.x) * p.y) / area;
+	}
+
+	int rowStart = max(minY, (int)floor(min(v[0].y, min(v[1].y, v[2].y))));
+	int rowEnd = min(maxY, (int)ceil(max(v[0].y, max(v[1].y, v[2].y))) + 1);
+	float center[4] = { (float)triangle.centerColor.r, (float)triangle.centerColor.g, (float)triangle.centerColor.b, (float)triangle.centerColor.a };
+	float outer[4] = { (float)triangle.outerColor.r, (float)triangle.outerColor.g, (float)triangle.outerColor.b, (float)triangle.outerColor.a };
+
+	for (int y = rowStart; y < rowEnd; y++)
+	{
+		float py = y + 0.5f;
+		float left = (float)minX;
+		float right = (float)maxX;
+		bool empty = false;
+		for (int i = 0; i < 3; i++)
+		{
+			float rowTerm = B[i] * py + C[i];
+			if (A[i] > 0)
+			{
+				left = max(left, -rowTerm / A[i]);
+			}
+			else if (A[i] < 0)
+			{
+				right = min(right, -rowTerm / A[i]);
+			}
+			else if (rowTerm < 0)
+			{
+				empty = true;
+			}
+		}
+		if (empty)
+		{
+			continue;
+		}
+
+		int start = max(minX, (int)ceil(left - 0.5f));
+		int end = min(maxX, (int)ceil(right - 0.5f));
+		if (start >= end)
+		{
+			continue;
+		}
+		float lambda = A[0] * (start + 0.5f) + B[0] * py + C[0];
+		blendSpan(&m_pixels[(y * m_size.x + start) * 4], end - start, lambda, A[0], center, outer);
+	}
+}
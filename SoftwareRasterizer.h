@@ -0,0 +1,52 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "ThreadPool.h"
+
+using namespace sf;
+using namespace std;
+
+// .:[Software Rasterizer]:.
+//          >> CPU draw backend for machines without a GPU. Particle fans are split into triangles, binned into
+//          >> 64x64 pixel tiles, and each tile is filled by one thread, so no two threads ever touch the same pixel.
+//          >> Triangles keep submission order inside a tile, which keeps alpha blending identical to SFML's.
+//          >> Colors blend from the fan center to its rim, and pixels use SFML's BlendAlpha equation.
+class SoftwareRasterizer
+{
+public:
+    static const int TILE_SIZE = 64;
+
+    explicit SoftwareRasterizer(ThreadPool& threadPool) : m_threadPool(threadPool) {}
+
+    ///Start a frame: resizes the framebuffer if needed and drops last frame's triangles
+    void begin(Vector2u size, Color clearColor = Color::Black);
+
+    ///Queue a fan: points[0] is the center, points[1..numPoints] the rim, all in pixel coordinates
+    void addFan(const Vector2f* points, int numPoints, Color centerColor, Color outerColor);
+
+    ///Fill every tile in parallel
+    void render();
+
+    ///RGBA8 framebuffer, ready for Texture::update() or Image::create()
+    const Uint8* getPixels() const { return m_pixels.data(); }
+    Vector2u getSize() const { return m_size; }
+
+private:
+    struct Triangle
+    {
+        Vector2f center, a, b;              // Center vertex first; a and b sit on the rim
+        Color centerColor, outerColor;
+    };
+
+    ThreadPool& m_threadPool;
+    Vector2u m_size;
+    int m_tilesX = 0;
+    int m_tilesY = 0;
+    Color m_clearColor;
+    vector<Uint8> m_pixels;
+    vector<Triangle> m_triangles;
+    vector<vector<int>> m_bins;             // Triangle indices per tile, in submission order
+
+    void renderTile(int tile);
+    void fillTriangle(const Triangle& triangle, int minX, int minY, int maxX, int maxY);
+};
@@ -0,0 +1,115 @@
+#include "SpatialSort.h"
+#include <algorithm>
+
+const int RADIX_BITS = 8;
+const int RADIX_BUCKETS = 1 << RADIX_BITS;
+const size_t MIN_CHUNK = 4096;              // Smaller runs aren't worth waking the pool for
+
+// .:[Bit Interleave]:.
+//          >> Spreads 16 bits out to the even bit positions
+static uint32_t spreadBits(uint32_t x)
+{
+	x &= 0xFFFF;
+	x = (x | (x << 8)) & 0x00FF00FF;
+	x = (x | (x << 4)) & 0x0F0F0F0F;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+uint32_t mortonCode(Vector2f center)
+{
+	float x = max(0.0f, min(center.x + 32768.0f, 65535.0f));
+	float y = max(0.0f, min(center.y + 32768.0f, 65535.0f));
+	return spreadBits((uint32_t)x) | (spreadBits((uint32_t)y) << 1);
+}
+
+// .:[Radix Sort]:.
+//          >> Per digit: every chunk counts its own keys, offsets are laid out digit-major then chunk, and every
+//          >> chunk scatters its keys in order, so the sort stays stable however many threads there are
+const vector<uint32_t>& MortonSorter::sort(ThreadPool& threadPool, const Particle* const* particles, size_t count)
+{
+	m_keys.resize(count);
+	m_keysOut.resize(count);
+	m_order.resize(count);
+	m_orderOut.resize(count);
+	int chunks = (int)max<size_t>(1, min<size_t>(threadPool.getThreadCount(), count / MIN_CHUNK));
+	size_t chunkSize = (count + chunks - 1) / chunks;
+	auto chunkRange = [&](int chunk, size_t& begin, size_t& end)
+	{
+		begin = min(count, chunk * chunkSize);
+		end = min(count, begin + chunkSize);
+	};
+
+	threadPool.parallelFor(chunks, [&](int first, int last)
+	{
+		for (int chunk = first; chunk < last; chunk++)
+		{
+			size_t begin, end;
+			chunkRange(chunk, begin, end);
+			for (size_t i = begin; i < end; i++)
+			{
+				m_keys[i] = mortonCode(particles[i]->getCenter());
+				m_order[i] = (uint32_t)i;
+			}
+		}
+	}, 1);
+
+	for (int shift = 0; shift < 32; shift += RADIX_BITS)
+	{
+		m_histograms.assign((size_t)chunks * RADIX_BUCKETS, 0);
+		threadPool.parallelFor(chunks, [&](int first, int last)
+		{
+			for (int chunk = first; chunk < last; chunk++)
+			{
+				size_t begin, end;
+				chunkRange(chunk, begin, end);
+				uint32_t* histogram = &m_histograms[(size_t)chunk * RADIX_BUCKETS];
+				for (size_t i = begin; i < end; i++)
+				{
+					histogram[(m_keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+				}
+			}
+		}, 1);
+
+		// >> Offsets in place of the counts; a digit that holds every key would scatter into the same order
+		uint32_t offset = 0;
+		bool shared = false;
+		for (int digit = 0; digit < RADIX_BUCKETS; digit++)
+		{
+			uint32_t total = 0;
+			for (int chunk = 0; chunk < chunks; chunk++)
+			{
+				uint32_t& bucket = m_histograms[(size_t)chunk * RADIX_BUCKETS + digit];
+				uint32_t bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+				total += bucketCount;
+			}
+			shared = shared || (total == count);
+		}
+		if (shared)
+		{
+			continue;
+		}
+
+		threadPool.parallelFor(chunks, [&](int first, int last)
+		{
+			for (int chunk = first; chunk < last; chunk++)
+			{
+				size_t begin, end;
+				chunkRange(chunk, begin, end);
+				uint32_t* offsets = &m_histograms[(size_t)chunk * RADIX_BUCKETS];
+				for (size_t i = begin; i < end; i++)
+				{
+					uint32_t target = offsets[(m_keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+					m_keysOut[target] = m_keys[i];
+					m_orderOut[target] = m_order[i];
+				}
+			}
+		}, 1);
+		m_keys.swap(m_keysOut);
+		m_order.swap(m_orderOut);
+	}
+	return m_order;
+}
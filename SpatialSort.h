@@ -0,0 +1,30 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Particle.h"
+#include "ThreadPool.h"
+
+using namespace sf;
+using namespace std;
+
+///Z-order key of a Cartesian center: 16 bits per axis, one pixel per cell, clamped to +-32768 pixels
+uint32_t mortonCode(Vector2f center);
+
+// .:[Morton Sorter]:.
+//          >> Orders a run of particles by the Morton code of their centers, so particles next to each other
+//          >> in memory are also next to each other on screen. LSD radix sort, four 8-bit digits; each digit's
+//          >> histogram and stable scatter are split into one chunk per thread, and a digit every key shares
+//          >> is skipped, which is common once a scene has settled into a few clusters.
+//          >> Scratch buffers are kept between calls.
+class MortonSorter
+{
+public:
+    ///Sorted position j holds the index of particles[order[j]]; the array stays valid until the next call
+    const vector<uint32_t>& sort(ThreadPool& threadPool, const Particle* const* particles, size_t count);
+
+private:
+    vector<uint32_t> m_keys, m_keysOut;
+    vector<uint32_t> m_order, m_orderOut;
+    vector<uint32_t> m_histograms;      // 256 per chunk, then offsets in place
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+// .:[SPSC Queue]:.
+//          >> Fixed-size ring for exactly one producer thread and one consumer thread, no locks.
+//          >> Each index is written by one side only; the release store that publishes it pairs with the
+//          >> other side's acquire load, so an item is always fully written before it can be read.
+//          >> The indices sit on separate cache lines so the two threads don't keep stealing one line.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    ///Producer only. Returns false, dropping the item, when the queue is full
+    bool push(const T& item)
+    {
+        size_t head = m_head.load(memory_order_relaxed);
+        if (head - m_tail.load(memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        m_items[head & (Capacity - 1)] = item;
+        m_head.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    ///Consumer only. Returns false when the queue is empty
+    bool pop(T& item)
+    {
+        size_t tail = m_tail.load(memory_order_relaxed);
+        if (tail == m_head.load(memory_order_acquire))
+        {
+            return false;
+        }
+        item = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return m_tail.load(memory_order_acquire) == m_head.load(memory_order_acquire); }
+
+private:
+    alignas(64) atomic<size_t> m_head{ 0 };        // Next slot to write; producer owns it
+    alignas(64) atomic<size_t> m_tail{ 0 };        // Next slot to read; consumer owns it
+    alignas(64) T m_items[Capacity];
+};
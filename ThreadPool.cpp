@@ -0,0 +1,109 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads)
+	: m_next(0)
+{
+	if (threads <= 0)
+	{
+		threads = max(1, (int)thread::hardware_concurrency());
+	}
+	for (int i = 1; i < threads; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+// .:[Parallel For]:.
+//          >> Small loops, or a pool with no workers, just run inline
+void ThreadPool::parallelFor(int count, const function<void(int begin, int end)>& job, int grain)
+{
+	parallelFor(count, [&job](int begin, int end, int) { job(begin, end); }, grain);
+}
+
+void ThreadPool::parallelFor(int count, const function<void(int begin, int end, int worker)>& job, int grain)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (grain <= 0)
+	{
+		grain = max(1, count / (getThreadCount() * 4));
+	}
+	if (m_workers.empty() || count <= grain)
+	{
+		job(0, count, 0);
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_job = &job;
+		m_count = count;
+		m_grain = grain;
+		m_next = 0;
+		m_active = (int)m_workers.size();
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	runChunks(0);
+
+	unique_lock<mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_active == 0; });
+	m_job = nullptr;
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+	int seenGeneration = 0;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+			if (m_stopping)
+			{
+				return;
+			}
+			seenGeneration = m_generation;
+		}
+
+		runChunks(worker);
+
+		lock_guard<mutex> lock(m_mutex);
+		if (--m_active == 0)
+		{
+			m_done.notify_one();
+		}
+	}
+}
+
+// .:[Chunk Loop]:.
+//          >> Threads take chunks off a shared counter until the range runs out
+void ThreadPool::runChunks(int worker)
+{
+	while (true)
+	{
+		int begin = m_next.fetch_add(m_grain);
+		if (begin >= m_count)
+		{
+			return;
+		}
+		(*m_job)(begin, min(begin + m_grain, m_count), worker);
+	}
+}
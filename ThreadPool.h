@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// .:[Thread Pool]:.
+//          >> Persistent worker threads for splitting a loop into chunks. The calling thread works too,
+//          >> and parallelFor() returns once every chunk is done. Not reentrant: jobs must not call parallelFor().
+class ThreadPool
+{
+public:
+    ///threads = total threads including the caller; 0 uses every hardware thread
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int getThreadCount() const { return (int)m_workers.size() + 1; }
+
+    ///Calls job(begin, end) over [0, count) in chunks of grain items; grain 0 picks about four chunks per thread
+    void parallelFor(int count, const function<void(int begin, int end)>& job, int grain = 0);
+
+    ///Same, also passing the running thread's index in [0, getThreadCount()), 0 being the caller, so jobs can
+    ///keep one scratch buffer per thread instead of allocating their own
+    void parallelFor(int count, const function<void(int begin, int end, int worker)>& job, int grain = 0);
+
+private:
+    vector<thread> m_workers;
+    mutex m_mutex;
+    condition_variable m_wake;
+    condition_variable m_done;
+    bool m_stopping = false;
+    int m_generation = 0;
+    int m_active = 0;
+
+    const function<void(int, int, int)>* m_job = nullptr;
+    int m_count = 0;
+    int m_grain = 1;
+    atomic<int> m_next;
+
+    void workerLoop(int worker);
+    void runChunks(int worker);
+};
@@ -0,0 +1,79 @@
+#include "Timeline.h"
+#include <algorithm>
+#include <functional>
+
+void Timeline::start(SceneScript script)
+{
+	pushFrame(m_frame + 1, script.release());
+}
+
+void Timeline::pushTimer(double time, coroutine_handle<> handle)
+{
+	m_timers.push_back({ time, m_order++, handle });
+	push_heap(m_timers.begin(), m_timers.end(), greater<Wake>());
+}
+
+void Timeline::pushFrame(uint64_t frame, coroutine_handle<> handle)
+{
+	m_frameWaits.push_back({ (double)frame, m_order++, handle });
+	push_heap(m_frameWaits.begin(), m_frameWaits.end(), greater<Wake>());
+}
+
+void Timeline::popDue(vector<Wake>& heap, double key, vector<coroutine_handle<>>& due)
+{
+	while (!heap.empty() && heap.front().key <= key)
+	{
+		due.push_back(heap.front().handle);
+		pop_heap(heap.begin(), heap.end(), greater<Wake>());
+		heap.pop_back();
+	}
+}
+
+// .:[Advance]:.
+//          >> Everything due is collected before anything runs, so a script that waits again this step lands
+//          >> back in a heap rather than in this step's batch
+void Timeline::advance(double now, size_t particles)
+{
+	m_now = now;
+	m_frame++;
+	m_particles = particles;
+
+	m_due.clear();
+	popDue(m_timers, now, m_due);
+	popDue(m_frameWaits, (double)m_frame, m_due);
+	multimap<size_t, coroutine_handle<>>::iterator waiting = m_countWaits.upper_bound(particles);
+	for (multimap<size_t, coroutine_handle<>>::iterator it = waiting; it != m_countWaits.end(); ++it)
+	{
+		m_due.push_back(it->second);
+	}
+	m_countWaits.erase(waiting, m_countWaits.end());
+
+	for (size_t i = 0; i < m_due.size(); i++)
+	{
+		m_due[i].resume();
+		if (m_due[i].done())
+		{
+			m_due[i].destroy();
+		}
+	}
+	m_due.clear();
+}
+
+void Timeline::clear()
+{
+	for (const Wake& wake : m_timers)
+	{
+		wake.handle.destroy();
+	}
+	for (const Wake& wake : m_frameWaits)
+	{
+		wake.handle.destroy();
+	}
+	for (const pair<const size_t, coroutine_handle<>>& wait : m_countWaits)
+	{
+		wait.second.destroy();
+	}
+	m_timers.clear();
+	m_frameWaits.clear();
+	m_countWaits.clear();
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+// .:[Scene Script]:.
+//          >> Return type of a timeline coroutine. A script is a plain member function that co_awaits the
+//          >> Timeline's delay(), nextFrame() and particlesBelow(); it does nothing until Timeline::start()
+//          >> takes it, and the Timeline destroys it once it finishes
+class SceneScript
+{
+public:
+    struct promise_type
+    {
+        SceneScript get_return_object() { return SceneScript(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend() noexcept { return {}; }
+        suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+
+    SceneScript(SceneScript&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+    SceneScript(const SceneScript&) = delete;
+    SceneScript& operator=(const SceneScript&) = delete;
+    ~SceneScript() { if (m_handle) m_handle.destroy(); }
+
+    ///Hand the coroutine over; the script no longer destroys it
+    coroutine_handle<> release() { coroutine_handle<> handle = m_handle; m_handle = nullptr; return handle; }
+
+private:
+    explicit SceneScript(coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    coroutine_handle<promise_type> m_handle;
+};
+
+// .:[Timeline]:.
+//          >> Runs scene scripts in simulated time. Suspended scripts wait in a min-heap on wake time, a
+//          >> min-heap on frame number, or a map keyed on particle count, so advance() only looks at the
+//          >> front of each: thousands of waiting scripts cost nothing until they are due.
+//          >> Scripts due in a step run in wake order (ties in the order they suspended), and anything they
+//          >> schedule is left for the next step, so a script can never starve the frame. Scripts run inside the
+//          >> simulation step, wherever that runs: on the simulation thread in live runs, on the main thread for
+//          >> replays, the video wall and offline renders. They wake on simulated time, so sessions replay them exactly.
+class Timeline
+{
+public:
+    Timeline() {}
+    ~Timeline() { clear(); }
+    Timeline(const Timeline&) = delete;
+    Timeline& operator=(const Timeline&) = delete;
+
+    ///The script first runs on the next advance()
+    void start(SceneScript script);
+
+    ///Call once per step with the simulated time and the live particle count
+    void advance(double now, size_t particles);
+
+    ///Destroy every suspended script
+    void clear();
+
+    size_t getScriptCount() const { return m_timers.size() + m_frameWaits.size() + m_countWaits.size(); }
+
+    ///Simulated time of the step scripts are running in
+    double getTime() const { return m_now; }
+
+    struct TimerAwaiter
+    {
+        Timeline& timeline;
+        double wakeTime;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(coroutine_handle<> handle) { timeline.pushTimer(wakeTime, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    struct FrameAwaiter
+    {
+        Timeline& timeline;
+        uint64_t wakeFrame;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(coroutine_handle<> handle) { timeline.pushFrame(wakeFrame, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    struct CountAwaiter
+    {
+        Timeline& timeline;
+        size_t below;
+        bool await_ready() const noexcept { return timeline.m_particles < below; }
+        void await_suspend(coroutine_handle<> handle) { timeline.m_countWaits.emplace(below, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    ///Wait seconds of simulated time; at least until the next step
+    TimerAwaiter delay(float seconds) { return { *this, m_now + seconds }; }
+
+    ///Wait frames steps
+    FrameAwaiter nextFrame(int frames = 1) { return { *this, m_frame + (uint64_t)(frames < 1 ? 1 : frames) }; }
+
+    ///Wait until fewer than count particles are alive; goes straight on if that's already true
+    CountAwaiter particlesBelow(size_t count) { return { *this, count }; }
+
+private:
+    struct Wake
+    {
+        double key;                     // Wake time or frame number
+        uint64_t order;                 // Breaks ties in suspension order
+        coroutine_handle<> handle;
+        bool operator>(const Wake& other) const { return key != other.key ? key > other.key : order > other.order; }
+    };
+
+    vector<Wake> m_timers;              // Min-heaps
+    vector<Wake> m_frameWaits;
+    multimap<size_t, coroutine_handle<>> m_countWaits;     // Keyed on the count to drop below
+    vector<coroutine_handle<>> m_due;
+    double m_now = 0.0;
+    uint64_t m_frame = 0;
+    uint64_t m_order = 0;
+    size_t m_particles = 0;
+
+    void pushTimer(double time, coroutine_handle<> handle);
+    void pushFrame(uint64_t frame, coroutine_handle<> handle);
+    static void popDue(vector<Wake>& heap, double key, vector<coroutine_handle<>>& due);
+};
@@ -0,0 +1,69 @@
+#include "TrailSlab.h"
+#include <algorithm>
+
+void TrailSlab::add(int length)
+{
+	m_rings.push_back({ 0, (uint8_t)max(0, min(length, MAX_TRAIL_LENGTH)), 0, 0, 0 });
+	m_points.resize(m_rings.size() * MAX_TRAIL_LENGTH);
+}
+
+// .:[Swap Remove]:.
+//          >> Only the points the moved ring actually holds are copied
+void TrailSlab::remove(size_t index)
+{
+	size_t last = m_rings.size() - 1;
+	if (index != last)
+	{
+		m_rings[index] = m_rings[last];
+		copy(m_points.begin() + last * MAX_TRAIL_LENGTH, m_points.begin() + last * MAX_TRAIL_LENGTH + m_rings[index].length,
+			m_points.begin() + index * MAX_TRAIL_LENGTH);
+	}
+	m_rings.pop_back();
+	m_points.resize(m_rings.size() * MAX_TRAIL_LENGTH);
+}
+
+void TrailSlab::reserve(size_t count)
+{
+	m_rings.reserve(count);
+	m_points.reserve(count * MAX_TRAIL_LENGTH);
+}
+
+void TrailSlab::clear()
+{
+	m_rings.clear();
+	m_points.clear();
+}
+
+void TrailSlab::record(size_t index, Vector2f position)
+{
+	Ring& ring = m_rings[index];
+	if (ring.length == 0)
+	{
+		return;
+	}
+	m_points[index * MAX_TRAIL_LENGTH + ring.head] = position;
+	ring.head = (ring.head + 1 == ring.length) ? 0 : ring.head + 1;
+	ring.count = min<int>(ring.count + 1, ring.length);
+	ring.stamp++;
+}
+
+// .:[Swap]:.
+//          >> Only as many points as the longer of the two rings holds are exchanged
+void TrailSlab::swap(size_t a, size_t b)
+{
+	std::swap(m_rings[a], m_rings[b]);
+	int length = max(m_rings[a].length, m_rings[b].length);
+	swap_ranges(m_points.begin() + a * MAX_TRAIL_LENGTH, m_points.begin() + a * MAX_TRAIL_LENGTH + length,
+		m_points.begin() + b * MAX_TRAIL_LENGTH);
+}
+
+Vector2f TrailSlab::getPoint(size_t index, int age) const
+{
+	const Ring& ring = m_rings[index];
+	int slot = ring.head - ring.count + age;
+	if (slot < 0)
+	{
+		slot += ring.length;
+	}
+	return m_points[index * MAX_TRAIL_LENGTH + slot];
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+using namespace sf;
+using namespace std;
+
+const int MAX_TRAIL_LENGTH = 16;        // Most center positions a trail can hold
+
+// .:[Trail Slab]:.
+//          >> The last few centers of every particle, in one flat array with MAX_TRAIL_LENGTH points reserved
+//          >> per particle; each particle uses the first length of its stretch as a ring buffer.
+//          >> Indices follow ParticleStore: trail i belongs to particle i, and remove() swaps the last trail
+//          >> into the hole just like the store does, so memory is only allocated when the particle count
+//          >> passes its previous high.
+class TrailSlab
+{
+public:
+    ///Append an empty trail keeping up to length points; 0 keeps none
+    void add(int length);
+    void remove(size_t index);
+    void reserve(size_t count);
+    void clear();
+
+    void record(size_t index, Vector2f position);
+
+    ///Exchange trails a and b
+    void swap(size_t a, size_t b);
+
+    ///Points held, at most the trail's length
+    int getCount(size_t index) const { return m_rings[index].count; }
+
+    ///age 0 is the oldest point held, getCount() - 1 the newest
+    Vector2f getPoint(size_t index, int age) const;
+
+    ///Bumped by every record(), so draw caches can tell a trail has moved
+    uint32_t getStamp(size_t index) const { return m_rings[index].stamp; }
+
+    size_t size() const { return m_rings.size(); }
+
+private:
+    struct Ring
+    {
+        uint32_t stamp;
+        uint8_t length;
+        uint8_t head;                   // Next slot to write
+        uint8_t count;
+        uint8_t padding;
+    };
+
+    vector<Ring> m_rings;
+    vector<Vector2f> m_points;          // MAX_TRAIL_LENGTH per ring
+};
@@ -0,0 +1,305 @@
+#include "VideoWall.h"
+#include <cmath>
+#include <iostream>
+
+// .:[Socket Helpers]:.
+//          >> Blocking sockets can still hand back part of a message; keep going until all of it has moved
+static bool sendAll(TcpSocket& socket, const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		size_t sent = 0;
+		Socket::Status status = socket.send(bytes, size, sent);
+		if (status != Socket::Done && status != Socket::Partial)
+		{
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool receiveAll(TcpSocket& socket, void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		size_t received = 0;
+		if (socket.receive(bytes, size, received) != Socket::Done)
+		{
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+static bool sendMessage(TcpSocket& socket, uint32_t frame, float dt, const vector<WallMigrant>& migrants)
+{
+	WallFrame header = { WALL_MAGIC, frame, dt, (uint32_t)migrants.size() };
+	return sendAll(socket, &header, sizeof(header))
+		&& (migrants.empty() || sendAll(socket, migrants.data(), migrants.size() * sizeof(WallMigrant)));
+}
+
+static bool receiveMessage(TcpSocket& socket, WallFrame& header, vector<WallMigrant>& migrants)
+{
+	if (!receiveAll(socket, &header, sizeof(header)) || header.magic != WALL_MAGIC || header.migrantCount > WALL_MAX_MIGRANTS)
+	{
+		return false;
+	}
+	migrants.resize(header.migrantCount);
+	return migrants.empty() || receiveAll(socket, migrants.data(), migrants.size() * sizeof(WallMigrant));
+}
+
+///////////////////////////////////////////////
+// Wall Node
+///////////////////////////////////////////////
+
+bool WallNode::connect(const string& host, unsigned short port, Vector2u tileSize)
+{
+	if (m_socket.connect(IpAddress(host), port) != Socket::Done)
+	{
+		cout << "Error: Cannot reach wall coordinator at " << host << ":" << port << endl;
+		return false;
+	}
+
+	WallHello hello = { WALL_MAGIC, tileSize.x, tileSize.y };
+	WallAssignment assignment;
+	if (!sendAll(m_socket, &hello, sizeof(hello)) || !receiveAll(m_socket, &assignment, sizeof(assignment))
+		|| assignment.magic != WALL_MAGIC)
+	{
+		cout << "Error: Wall coordinator at " << host << ":" << port << " did not assign a tile" << endl;
+		m_socket.disconnect();
+		return false;
+	}
+
+	m_tile = assignment.tile;
+	m_columns = assignment.columns;
+	m_rows = assignment.rows;
+	m_tileSize = Vector2f(tileSize);
+	m_connected = true;
+	cout << "Joined video wall as tile " << m_tile << " of " << m_columns << "x" << m_rows << endl;
+	return true;
+}
+
+void WallNode::disconnect()
+{
+	if (m_connected)
+	{
+		m_socket.disconnect();
+		m_connected = false;
+	}
+}
+
+// .:[Begin Frame]:.
+//          >> Doubles as the frame barrier: this blocks until the coordinator has heard from every tile
+bool WallNode::beginFrame(float& dt, vector<ParticleState>& arrivals)
+{
+	WallFrame header;
+	vector<WallMigrant> migrants;
+	if (!m_connected || !receiveMessage(m_socket, header, migrants))
+	{
+		disconnect();
+		return false;
+	}
+
+	m_frame = header.frame;
+	dt = header.dt;
+	arrivals.resize(migrants.size());
+	for (size_t i = 0; i < migrants.size(); i++)
+	{
+		arrivals[i] = migrants[i].state;
+	}
+	return true;
+}
+
+// .:[Tile Lookup]:.
+//          >> Leaving this tile's rectangle is checked first since almost every particle is still inside it
+int WallNode::findTile(Vector2f center) const
+{
+	if (fabsf(center.x) <= m_tileSize.x * 0.5f && fabsf(center.y) <= m_tileSize.y * 0.5f)
+	{
+		return -1;
+	}
+
+	Vector2f world = center + getTileOffset(m_tile);
+	int column = (int)floorf((world.x + m_columns * m_tileSize.x * 0.5f) / m_tileSize.x);
+	int row = (int)floorf((m_rows * m_tileSize.y * 0.5f - world.y) / m_tileSize.y);
+	if (column < 0 || column >= m_columns || row < 0 || row >= m_rows)
+	{
+		return -1;
+	}
+	int tile = row * m_columns + column;
+	return (tile == m_tile) ? -1 : tile;
+}
+
+bool WallNode::emigrate(int tile, const ParticleState& state)
+{
+	if (m_outgoing.size() >= WALL_MAX_MIGRANTS)
+	{
+		return false;
+	}
+	Vector2f shift = getTileOffset(m_tile) - getTileOffset(tile);
+	WallMigrant migrant = {};
+	migrant.tile = tile;
+	migrant.state = state;
+	migrant.state.centerX += shift.x;
+	migrant.state.centerY += shift.y;
+	for (int i = 0; i < migrant.state.numPoints; i++)
+	{
+		migrant.state.points[i][0] += shift.x;
+		migrant.state.points[i][1] += shift.y;
+	}
+	m_outgoing.push_back(migrant);
+	return true;
+}
+
+bool WallNode::endFrame()
+{
+	bool sent = m_connected && sendMessage(m_socket, m_frame, 0.0f, m_outgoing);
+	m_outgoing.clear();
+	if (!sent)
+	{
+		disconnect();
+	}
+	return sent;
+}
+
+// .:[Tile Offset]:.
+//          >> Where a tile's origin sits in the world plane, whose origin is the middle of the whole wall
+Vector2f WallNode::getTileOffset(int tile) const
+{
+	int column = tile % m_columns;
+	int row = tile / m_columns;
+	return Vector2f((column + 0.5f) * m_tileSize.x - m_columns * m_tileSize.x * 0.5f,
+		m_rows * m_tileSize.y * 0.5f - (row + 0.5f) * m_tileSize.y);
+}
+
+///////////////////////////////////////////////
+// Wall Coordinator
+///////////////////////////////////////////////
+
+// .:[Listen]:.
+//          >> Tiles are handed out in connection order
+bool WallCoordinator::listen(unsigned short port, int columns, int rows)
+{
+	if (m_listener.listen(port) != Socket::Done)
+	{
+		cout << "Error: Wall coordinator cannot listen on port " << port << endl;
+		return false;
+	}
+	m_columns = columns;
+	m_rows = rows;
+	int tiles = columns * rows;
+	m_nodes.resize(tiles);
+	m_arrivals.resize(tiles);
+	cout << "Wall coordinator waiting for " << tiles << " nodes on port " << port << endl;
+
+	Vector2u tileSize;
+	for (int tile = 0; tile < tiles; tile++)
+	{
+		unique_ptr<TcpSocket> node(new TcpSocket);
+		WallHello hello;
+		if (m_listener.accept(*node) != Socket::Done || !receiveAll(*node, &hello, sizeof(hello)) || hello.magic != WALL_MAGIC)
+		{
+			tile--;
+			continue;
+		}
+		if (tile == 0)
+		{
+			tileSize = Vector2u(hello.windowWidth, hello.windowHeight);
+		}
+		else if (tileSize != Vector2u(hello.windowWidth, hello.windowHeight))
+		{
+			cout << "Warning: Node " << tile << " is " << hello.windowWidth << "x" << hello.windowHeight
+				<< ", tile edges will not line up" << endl;
+		}
+		cout << "Node " << node->getRemoteAddress().toString() << " is tile " << tile << endl;
+		m_nodes[tile] = move(node);
+	}
+	m_listener.close();
+
+	for (int tile = 0; tile < tiles; tile++)
+	{
+		WallAssignment assignment = { WALL_MAGIC, tile, columns, rows };
+		if (!sendAll(*m_nodes[tile], &assignment, sizeof(assignment)))
+		{
+			dropNode(tile);
+		}
+	}
+	return true;
+}
+
+// .:[Frame Loop]:.
+//          >> Every node gets its frame before any answer is awaited, so the tiles step in parallel
+void WallCoordinator::run(int fps)
+{
+	float dt = 1.0f / fps;
+	for (uint32_t frame = 0; ; frame++)
+	{
+		Clock frameClock;
+		for (size_t tile = 0; tile < m_nodes.size(); tile++)
+		{
+			sendFrame(tile, frame, dt);
+		}
+
+		bool anyNodes = false;
+		for (size_t tile = 0; tile < m_nodes.size(); tile++)
+		{
+			receiveMigrants(tile, frame);
+			anyNodes = anyNodes || m_nodes[tile] != nullptr;
+		}
+		if (!anyNodes)
+		{
+			cout << "Every wall node has left after " << frame << " frames" << endl;
+			return;
+		}
+		sleep(seconds(dt) - frameClock.getElapsedTime());
+	}
+}
+
+void WallCoordinator::sendFrame(int tile, uint32_t frame, float dt)
+{
+	if (m_nodes[tile] && !sendMessage(*m_nodes[tile], frame, dt, m_arrivals[tile]))
+	{
+		dropNode(tile);
+	}
+	m_arrivals[tile].clear();
+}
+
+// .:[Routing]:.
+//          >> Migrants are passed along untouched; the sending node already moved them into the destination's plane
+void WallCoordinator::receiveMigrants(int tile, uint32_t frame)
+{
+	if (!m_nodes[tile])
+	{
+		return;
+	}
+
+	WallFrame header;
+	vector<WallMigrant> migrants;
+	if (!receiveMessage(*m_nodes[tile], header, migrants) || header.frame != frame)
+	{
+		dropNode(tile);
+		return;
+	}
+	for (const WallMigrant& migrant : migrants)
+	{
+		// >> A tile's arrivals are capped like any message; past that, migrants are lost rather than the node
+		if (migrant.tile >= 0 && migrant.tile < (int)m_nodes.size() && m_nodes[migrant.tile]
+			&& m_arrivals[migrant.tile].size() < WALL_MAX_MIGRANTS)
+		{
+			m_arrivals[migrant.tile].push_back(migrant);
+		}
+	}
+}
+
+void WallCoordinator::dropNode(int tile)
+{
+	cout << "Wall node for tile " << tile << " disconnected" << endl;
+	m_nodes[tile].reset();
+	m_arrivals[tile].clear();
+}
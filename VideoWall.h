@@ -0,0 +1,117 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Particle.h"
+
+using namespace sf;
+using namespace std;
+
+// .:[Video Wall Protocol]:.
+//          >> The world plane is a grid of columns x rows tiles, one node process per tile, each drawing its
+//          >> tile in its own window. A node's particles stay in that node's Cartesian plane (origin at its
+//          >> window center); crossing into a neighbour's tile shifts the particle into the neighbour's plane.
+//          >> Every node holds one TCP connection to the coordinator, which runs the frame loop in lockstep:
+//          >>      coordinator -> node     WallFrame, then that node's arriving WallMigrants
+//          >>      node -> coordinator     WallFrame (same frame number), then its leaving WallMigrants
+//          >> The coordinator only sends frame n + 1 after every node has answered frame n, so all tiles
+//          >> step the same fixed dt and a migrant lands exactly one frame after it left.
+//          >> Messages are plain structs in native byte order, like snapshots; every machine on the wall is
+//          >> expected to run the same build.
+const uint32_t WALL_MAGIC = 0x4C4C4157;        // "WALL"
+const unsigned short WALL_DEFAULT_PORT = 47000;
+const uint32_t WALL_MAX_MIGRANTS = 65536;      // Most migrants one message may carry; a larger count drops the sender
+
+struct WallHello                        // node -> coordinator once connected
+{
+    uint32_t magic;
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+};
+
+struct WallAssignment                   // coordinator -> node, once every tile has a node
+{
+    uint32_t magic;
+    int32_t tile;                       // Row-major, row 0 at the top
+    int32_t columns;
+    int32_t rows;
+};
+
+struct WallFrame
+{
+    uint32_t magic;
+    uint32_t frame;
+    float dt;
+    uint32_t migrantCount;              // WallMigrants following this header
+};
+
+struct WallMigrant
+{
+    int32_t tile;                       // Destination tile; the state is already in that tile's plane
+    uint32_t padding;
+    ParticleState state;
+};
+
+// .:[Wall Node]:.
+//          >> One tile's end of the connection. Engine::run() takes each step's dt from beginFrame() and hands
+//          >> over whatever left its tile before calling endFrame()
+class WallNode
+{
+public:
+    ///Blocks until the coordinator has a node for every tile and assigns this one
+    bool connect(const string& host, unsigned short port, Vector2u tileSize);
+    void disconnect();
+    bool isConnected() const { return m_connected; }
+    int getTile() const { return m_tile; }
+
+    ///Blocks for the next frame; arrivals are replaced with the particles that crossed into this tile.
+    ///Returns false once the coordinator is gone
+    bool beginFrame(float& dt, vector<ParticleState>& arrivals);
+
+    ///Tile a particle centered here (in this tile's plane) belongs to, or -1 while it is still this tile's;
+    ///particles outside the wall altogether stay where they are
+    int findTile(Vector2f center) const;
+
+    ///Shift state into tile's plane and queue it for this frame; returns false once WALL_MAX_MIGRANTS are queued
+    bool emigrate(int tile, const ParticleState& state);
+
+    ///Send this frame's emigrants; returns false once the coordinator is gone
+    bool endFrame();
+
+private:
+    TcpSocket m_socket;
+    bool m_connected = false;
+    int m_tile = -1;
+    int m_columns = 1;
+    int m_rows = 1;
+    Vector2f m_tileSize;
+    uint32_t m_frame = 0;
+    vector<WallMigrant> m_outgoing;
+
+    Vector2f getTileOffset(int tile) const;
+};
+
+// .:[Wall Coordinator]:.
+//          >> Headless; accepts one node per tile, then paces frames and routes migrants between them.
+//          >> A node that drops out leaves a dark tile, and particles heading into it are discarded
+class WallCoordinator
+{
+public:
+    bool listen(unsigned short port, int columns, int rows);
+
+    ///Runs until every node has disconnected
+    void run(int fps);
+
+private:
+    TcpListener m_listener;
+    vector<unique_ptr<TcpSocket>> m_nodes;      // Indexed by tile; null once a node is gone
+    vector<vector<WallMigrant>> m_arrivals;     // Routed to each tile, sent with the next frame
+    int m_columns = 1;
+    int m_rows = 1;
+
+    void sendFrame(int tile, uint32_t frame, float dt);
+    void receiveMigrants(int tile, uint32_t frame);
+    void dropNode(int tile);
+};
@@ -1,9 +1,149 @@
 #include "Engine.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+	// Offline rendering and the unit tests run without a window, so they have to be known before the engine is created
+	bool offline = false;
+	bool unitTests = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string option = argv[i];
+		if (option == "--render" || option == "--render-video")
+		{
+			offline = true;
+		}
+		else if (option == "--unit-tests")
+		{
+			unitTests = true;
+		}
+		// A wall coordinator has no engine at all; it only paces the nodes and passes particles between them
+		else if (option == "--wall-coordinator" && i + 3 < argc)
+		{
+			WallCoordinator coordinator;
+			if (!coordinator.listen(atoi(argv[i + 1]), max(1, atoi(argv[i + 2])), max(1, atoi(argv[i + 3]))))
+			{
+				return 1;
+			}
+			coordinator.run(60);
+			return 0;
+		}
+	}
+
 	// Declare an instance of Engine
-	Engine engine;
+	Engine engine(offline || unitTests);
+	if (unitTests)
+	{
+		return engine.unitTests() ? 0 : 1;
+	}
+
+	// Command line options
+	//		--record <file>		Log this session's input for later replay
+	//		--replay <file>		Re-simulate a logged session instead of reading live input
+	//		--snapshot <file>	Warm-start from a saved snapshot (F5 saves one, F9 reloads it)
+	//		--render <prefix>	Render offline to prefix_00000.png, prefix_00001.png, ...
+	//		--render-video <file>	Render offline and pipe the frames into ffmpeg
+	//		--frames <n>		Number of frames to render offline (default 600)
+	//		--fps <n>			Offline frame rate and fixed timestep (default 60)
+	//		--software			Draw particles with the multithreaded CPU rasterizer instead of SFML
+	//		--compact			Keep new particles in the packed 28-byte representation
+	//		--dust <n>			Keep n dust grains alive across the window (up to 1048576)
+	//		--max-particles <n>	Hard cap on live particles (default 50000)
+	//		--target-fps <n>	Frame rate quality is degraded to hold (default 60)
+	//		--wall-coordinator <port> <columns> <rows>	Run the coordinator of a video wall instead of the engine
+	//		--wall-node <host> <port>	Join a video wall as one of its tiles
+	//		--metrics <name>	Publish live counters to shared memory for tools/particle-metrics
+	//		--unit-tests		Run the headless engine checks and exit; the status is 0 when all pass
+	size_t maxParticles = 50000;
+	float targetFps = 60.0f;
+	string recordPath;
+	string replayPath;
+	string renderOutput;
+	bool renderVideo = false;
+	int renderFrames = 600;
+	int renderFps = 60;
+	for (int i = 1; i < argc; i++)
+	{
+		string option = argv[i];
+		if (option == "--record" && i + 1 < argc)
+		{
+			recordPath = argv[++i];
+		}
+		else if (option == "--replay" && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		else if (option == "--snapshot" && i + 1 < argc)
+		{
+			engine.loadSnapshot(argv[++i]);
+		}
+		else if ((option == "--render" || option == "--render-video") && i + 1 < argc)
+		{
+			renderVideo = (option == "--render-video");
+			renderOutput = argv[++i];
+		}
+		else if (option == "--frames" && i + 1 < argc)
+		{
+			renderFrames = atoi(argv[++i]);
+		}
+		else if (option == "--fps" && i + 1 < argc)
+		{
+			renderFps = max(1, atoi(argv[++i]));
+		}
+		else if (option == "--wall-node" && i + 2 < argc)
+		{
+			string host = argv[++i];
+			if (!engine.joinWall(host, atoi(argv[++i])))
+			{
+				return 1;
+			}
+		}
+		else if (option == "--metrics" && i + 1 < argc)
+		{
+			engine.openMetrics(argv[++i]);
+		}
+		else if (option == "--software")
+		{
+			engine.setSoftwareRendering(true);
+		}
+		else if (option == "--compact")
+		{
+			engine.setCompactParticles(true);
+		}
+		else if (option == "--dust" && i + 1 < argc)
+		{
+			engine.setDustFloor(max(0, atoi(argv[++i])));
+		}
+		else if (option == "--max-particles" && i + 1 < argc)
+		{
+			maxParticles = max(0, atoi(argv[++i]));
+		}
+		else if (option == "--target-fps" && i + 1 < argc)
+		{
+			targetFps = max(1.0, atof(argv[++i]));
+		}
+		else
+		{
+			cout << "Unknown option: " << option << endl;
+		}
+	}
+
+	engine.setParticleBudget(maxParticles, targetFps);
+
+	// Sessions start once every option is in, since the log records the ones that change the simulation
+	if (!replayPath.empty() && !engine.startReplay(replayPath))
+	{
+		return 1;
+	}
+	if (!recordPath.empty())
+	{
+		engine.startRecording(recordPath);
+	}
+
+	if (offline)
+	{
+		return engine.renderOffline(renderOutput, renderVideo, renderFrames, renderFps) ? 0 : 1;
+	}
+
 	// Start the engine
 	engine.run();
 	// Quit in the usual way when the engine is stopped
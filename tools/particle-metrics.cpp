@@ -0,0 +1,140 @@
+// .:[Particle Metrics Reader]:.
+//          >> Maps the engine's metrics segment read-only and prints it, once or on an interval, either for people
+//          >> or in Prometheus text format for a scraper. Never writes to the segment, so it can't slow the engine.
+//          >>      particle-metrics <name> [--watch <seconds>] [--prometheus]
+#include "MetricsExport.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char* TYPE_NAMES[METRICS_TYPES] = { "random", "normal", "constant", "wave", "grow" };
+static const char* STAGE_NAMES[] = { "full", "reduced points", "throttled", "culling" };
+
+static void printReadable(const MetricsData& data)
+{
+	cout << "frame " << data.frame << "   sim " << data.simTime << " s   quality " << STAGE_NAMES[data.qualityStage % 4] << endl;
+	cout << "particles " << data.particles << " / " << data.maxParticles << " (store holds " << data.storeCapacity << ")" << endl;
+	for (int type = 1; type < METRICS_TYPES; type++)
+	{
+		cout << "    " << TYPE_NAMES[type] << " " << data.particlesByType[type] << endl;
+	}
+	cout << "spawned " << data.spawnedTotal << " (" << data.spawnRate << "/s)   allocated " << data.allocatedTotal
+		<< " (" << data.allocationRate << "/s)" << endl;
+	cout << "frame " << data.frameTime << " ms   work " << data.workTime << " ms" << endl;
+	for (int bucket = 0; bucket < FRAME_TIME_BUCKETS; bucket++)
+	{
+		if (bucket < FRAME_TIME_BUCKETS - 1)
+		{
+			cout << "    <= " << FRAME_TIME_BOUNDS[bucket] << " ms  ";
+		}
+		else
+		{
+			cout << "     > " << FRAME_TIME_BOUNDS[bucket - 1] << " ms  ";
+		}
+		cout << data.frameTimeHistogram[bucket] << endl;
+	}
+}
+
+// >> Buckets are cumulative in Prometheus, so each le line carries every frame at or under its bound
+static void printPrometheus(const MetricsData& data)
+{
+	cout << "particles_frame " << data.frame << "\n";
+	cout << "particles_sim_seconds " << data.simTime << "\n";
+	cout << "particles_live " << data.particles << "\n";
+	for (int type = 1; type < METRICS_TYPES; type++)
+	{
+		cout << "particles_live_by_type{type=\"" << TYPE_NAMES[type] << "\"} " << data.particlesByType[type] << "\n";
+	}
+	cout << "particles_max " << data.maxParticles << "\n";
+	cout << "particles_store_capacity " << data.storeCapacity << "\n";
+	cout << "particles_spawned_total " << data.spawnedTotal << "\n";
+	cout << "particles_allocated_total " << data.allocatedTotal << "\n";
+	cout << "particles_quality_stage " << data.qualityStage << "\n";
+	uint64_t cumulative = 0;
+	for (int bucket = 0; bucket < FRAME_TIME_BUCKETS; bucket++)
+	{
+		cumulative += data.frameTimeHistogram[bucket];
+		if (bucket < FRAME_TIME_BUCKETS - 1)
+		{
+			cout << "particles_frame_ms_bucket{le=\"" << FRAME_TIME_BOUNDS[bucket] << "\"} " << cumulative << "\n";
+		}
+	}
+	cout << "particles_frame_ms_bucket{le=\"+Inf\"} " << cumulative << "\n";
+	cout << "particles_frame_ms_count " << cumulative << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		cout << "Usage: particle-metrics <name> [--watch <seconds>] [--prometheus]" << endl;
+		return 1;
+	}
+	string name = argv[1];
+	if (name[0] != '/')
+	{
+		name = "/" + name;
+	}
+	double interval = 0.0;
+	bool prometheus = false;
+	for (int i = 2; i < argc; i++)
+	{
+		string option = argv[i];
+		if (option == "--watch" && i + 1 < argc)
+		{
+			interval = atof(argv[++i]);
+		}
+		else if (option == "--prometheus")
+		{
+			prometheus = true;
+		}
+	}
+
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		cout << "Error: No metrics at " << name << "; is the engine running with --metrics?" << endl;
+		return 1;
+	}
+	void* mapping = mmap(nullptr, sizeof(MetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		cout << "Error: Cannot map " << name << endl;
+		return 1;
+	}
+	const MetricsSegment& segment = *(const MetricsSegment*)mapping;
+	if (segment.magic != METRICS_MAGIC || segment.version != METRICS_VERSION || segment.dataSize != sizeof(MetricsData))
+	{
+		cout << "Error: " << name << " is not a metrics segment this reader understands" << endl;
+		return 1;
+	}
+
+	do
+	{
+		MetricsData data;
+		if (!readMetrics(segment, data))
+		{
+			cout << "Error: The engine kept writing; try again" << endl;
+			return 1;
+		}
+		if (prometheus)
+		{
+			printPrometheus(data);
+		}
+		else
+		{
+			printReadable(data);
+			if (interval > 0.0)
+			{
+				cout << endl;
+			}
+		}
+		this_thread::sleep_for(chrono::duration<double>(interval));
+	} while (interval > 0.0);
+	return 0;
+}